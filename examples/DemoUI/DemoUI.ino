@@ -62,8 +62,19 @@ Link nextPageLink("Next", "/next");
 Label settingsTitle("Settings");
 Label configSection("Configuration");
 Label optionsSection("Options");
-Button btn7("Save", [](){ Serial.println("Save pressed"); });
-Button btn8("Reset", [](){ Serial.println("Reset pressed"); });
+const char* const confirmOptions[] = { "Yes", "No" };
+void onResetChoice(int choice) {
+    Serial.println(choice == 0 ? "Reset confirmed" : "Reset cancelled");
+}
+// In threaded mode the render task owns the overlay, so go through renderQueue
+Button btn7("Save", [](){
+    if (renderQueue.isEnabled()) renderQueue.showToast("Settings saved");
+    else overlay.showToast("Settings saved");
+});
+Button btn8("Reset", [](){
+    if (renderQueue.isEnabled()) renderQueue.showDialog("Reset settings?", confirmOptions, 2, onResetChoice);
+    else overlay.showDialog("Reset settings?", confirmOptions, 2, onResetChoice);
+});
 RadioButton setting1("Mode A"), setting2("Mode B"), setting3("Mode C");
 CheckBox option1("Auto Save"), option2("Debug Mode"), option3("Verbose");
 Link homeLink("Home", "home");
@@ -80,6 +91,7 @@ Button btn10("Debug", [](){ Serial.println("Debug pressed"); });
 CheckBox cb4("Show Tips"), cb5("Auto Update");
 Link homeLink2("Home", "home");
 Link settingsLink2("Settings", "settings");
+Chart signalChart(-1.0, 1.0, 4); // 4 samples per pixel column
 
 // Advanced Page Widgets
 Label advancedTitle("Advanced");
@@ -126,7 +138,7 @@ Widget* aboutGrid[TOTAL_ROWS][COLS] = {
     { &btn9, nullptr, &btn10 },
     { &cb4, &cb5, nullptr },
     { &settingsLink2, nullptr, nullptr },
-    { nullptr, nullptr, nullptr },
+    { &signalChart, nullptr, nullptr },
     { nullptr, nullptr, nullptr }
 };
 
@@ -194,6 +206,9 @@ void changeThemeToGreen() {
 
 // Custom input handler to include application-specific logic (like clicking the title)
 void myCustomInputHandler() {
+    // An open dialog takes the 5-way input until it is closed
+    if (overlay.handleInput()) return;
+
     Page* currentPage = pageManager.getCurrentPage();
     if (!currentPage) return;
 
@@ -298,6 +313,10 @@ void setup() {
     // This single function initializes the TFT, sprite, and input pins
     initDisplay();
 
+    // Optional: keep compressed snapshots of recent pages for instant back/next
+    static uint8_t snapshotBuffer[8192];
+    snapshotCache.begin(snapshotBuffer, sizeof(snapshotBuffer));
+
     // Add all our pages to the page manager
     pageManager.addPage(&homePage);
     pageManager.addPage(&settingsPage);
@@ -318,6 +337,9 @@ void loop() {
 
     // Handle any incoming serial commands
     myCustomSerialHandler();
+
+    // Feed the chart with a test signal; only new columns are redrawn
+    signalChart.addSample(sin(millis() / 300.0));
     
     // Get the current page and draw it with the current selection
     Page* currentPage = pageManager.getCurrentPage();
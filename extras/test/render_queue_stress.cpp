@@ -0,0 +1,129 @@
+// Host-side stress test for RenderQueue: one thread posts commands as the app task
+// would, another applies them and renders frames. Build with MULTIPAGEUI_TSAN=ON to
+// have ThreadSanitizer check the queue handoff.
+#include "MultiPageUI.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Not assert(): the checks must also run in release builds, where NDEBUG is defined
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+using namespace MultiPageUI;
+
+static int presses = 0;
+static int choices = 0;
+static std::thread::id appThread;
+
+static const char* const confirmOptions[] = { "Yes", "No" };
+
+// Overlay choices must come back through dispatchEvents() on the posting thread
+static void onChoice(int) {
+    CHECK(std::this_thread::get_id() == appThread);
+    choices++;
+}
+
+Label title("Title");
+Button button("Press", [] { presses++; });
+CheckBox checkBox("Check");
+RadioButton radioA("A");
+RadioButton radioB("B");
+Chart chart(0, 100, 2);
+Link next("Next", "/second");
+
+Widget* firstGrid[8][3] = {
+    {&title, nullptr, &button},
+    {&checkBox, nullptr, nullptr},
+    {&radioA, &radioB, nullptr},
+    {&chart, nullptr, nullptr},
+    {&next, nullptr, nullptr}
+};
+
+Label secondTitle("Second");
+Link back("Back", "/back");
+
+Widget* secondGrid[8][3] = {
+    {&secondTitle, nullptr, &back}
+};
+
+Page first("first", firstGrid);
+Page second("second", secondGrid);
+
+static UICommand commandBuffer[64];
+
+// The test wants every command delivered, so a full queue is retried instead of dropped
+template <typename F>
+static void postRetrying(F post) {
+    while (!post()) std::this_thread::yield();
+}
+
+int main() {
+    const int COMMANDS = 200000;
+
+    initDisplay();
+    pageManager.addPage(&first);
+    pageManager.addPage(&second);
+    pageManager.setTransition(T_SLIDE, 2);
+    renderQueue.enable(commandBuffer, sizeof(commandBuffer) / sizeof(commandBuffer[0]));
+
+    appThread = std::this_thread::get_id();
+    std::atomic<bool> done(false);
+    long frames = 0;
+    std::thread render([&] {
+        while (!done.load()) {
+            renderQueue.renderFrame();
+            frames++;
+        }
+    });
+
+    // Focus only moves along the top row, so presses never land on the check box
+    int toggles = 0;
+    int samplesDropped = 0;
+    char text[32];
+    for (int i = 0; i < COMMANDS; i++) {
+        snprintf(text, sizeof(text), "v%d", i);
+        switch (i % 9) {
+            case 0: postRetrying([&] { return renderQueue.setText(&title, text); }); break;
+            case 1: postRetrying([&] { return renderQueue.toggle(&checkBox); }); toggles++; break;
+            case 2: postRetrying([&] { return renderQueue.selectRadio(&first, 2, (i & 1) ? &radioA : &radioB); }); break;
+            case 3: if (!renderQueue.addSample(&chart, (float)(i % 100))) samplesDropped++; break;
+            case 4: if (i % 900 == 4) postRetrying([&] { return renderQueue.goNext(); }); break;
+            case 5: if (i % 900 == 5) postRetrying([&] { return renderQueue.navigateToPage("first"); }); break;
+            case 6: postRetrying([&] { return renderQueue.moveFocus((i & 1) ? CMD_MOVE_LEFT : CMD_MOVE_RIGHT); }); break;
+            case 7:
+                if (i % 300 == 7) postRetrying([&] { return renderQueue.setTheme((i & 2) ? &redTheme : &defaultTheme); });
+                if (i % 450 == 7) postRetrying([&] { return renderQueue.showDialog("Sure?", confirmOptions, 2, onChoice); });
+                if (i % 450 == 16) postRetrying([&] { return renderQueue.showToast(text, 5); });
+                break;
+            case 8: postRetrying([&] { return renderQueue.press(); }); renderQueue.dispatchEvents(); break;
+        }
+    }
+    postRetrying([&] { return renderQueue.setText(&title, "final"); });
+    postRetrying([&] { return renderQueue.selectRadio(&first, 2, &radioB); });
+
+    done = true;
+    render.join();
+    renderQueue.applyPending();
+    renderQueue.renderFrame();
+    renderQueue.dispatchEvents();
+
+    // getDropped() also counts the full-queue attempts that were retried above
+    CHECK(choices > 0);
+    printf("frames %ld, rejected posts %u, samples dropped %d, choices %d\n",
+           frames, renderQueue.getDropped(), samplesDropped, choices);
+
+    CHECK(strcmp(title.getText(), "final") == 0);
+    CHECK(checkBox.isChecked() == (toggles % 2 == 1));
+    CHECK(radioB.isSelected() && !radioA.isSelected());
+    CHECK(!chart.hasPendingUpdate());
+
+    puts("PASS");
+    return 0;
+}
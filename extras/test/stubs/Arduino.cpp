@@ -0,0 +1,14 @@
+#include "Arduino.h"
+#include <chrono>
+
+SerialStub Serial;
+
+unsigned long micros() {
+    static auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
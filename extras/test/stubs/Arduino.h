@@ -0,0 +1,44 @@
+// Minimal host stand-in for the Arduino core, enough to build the library on a PC.
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define LOW 0
+#define HIGH 1
+#define INPUT_PULLUP 2
+
+enum { WIO_5S_UP = 1, WIO_5S_DOWN, WIO_5S_LEFT, WIO_5S_RIGHT, WIO_5S_PRESS };
+
+inline int digitalRead(int) { return HIGH; }
+inline void pinMode(int, int) {}
+inline void delay(unsigned long) {}
+unsigned long millis();
+unsigned long micros();
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s) {}
+    String(const std::string& s) : std::string(s) {}
+    bool startsWith(const char* prefix) const { return rfind(prefix, 0) == 0; }
+    String substring(size_t from) const { return String(substr(from)); }
+    void trim() {}
+};
+
+struct SerialStub {
+    void begin(long) {}
+    int available() { return 0; }
+    String readStringUntil(char) { return String(); }
+    template <typename T> void print(const T&) {}
+    template <typename T> void println(const T&) {}
+    void println() {}
+};
+extern SerialStub Serial;
+
+#endif
@@ -0,0 +1,108 @@
+// Minimal host stand-in for TFT_eSPI: a 320x240 "screen" that records pushes,
+// and a 16-bit sprite backed by a plain buffer.
+#ifndef TFT_ESPI_STUB_H
+#define TFT_ESPI_STUB_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_ORANGE 0xFDA0
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+
+#define ML_DATUM 3
+#define MC_DATUM 4
+
+class TFT_eSPI {
+public:
+    static const int WIDTH = 320;
+    static const int HEIGHT = 240;
+
+    TFT_eSPI() : screen(WIDTH * HEIGHT, 0), swapBytes(false), pushed(0) {}
+    int width() { return WIDTH; }
+    int height() { return HEIGHT; }
+    void init() {}
+    void setRotation(int) {}
+    void setTextColor(uint16_t) {}
+    void setTextFont(int) {}
+    bool getSwapBytes() { return swapBytes; }
+    void setSwapBytes(bool swap) { swapBytes = swap; }
+    void startWrite() {}
+    void endWrite() {}
+
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data) {
+        pushed += (long)w * h;
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                int sx = x + i, sy = y + j;
+                if (sx >= 0 && sy >= 0 && sx < WIDTH && sy < HEIGHT) screen[sy * WIDTH + sx] = data[j * w + i];
+            }
+        }
+    }
+
+    std::vector<uint16_t> screen;
+    bool swapBytes;
+    long pushed;
+};
+
+class TFT_eSprite {
+public:
+    explicit TFT_eSprite(TFT_eSPI* tft) : tft(tft), w(0), h(0) {}
+
+    void* createSprite(int16_t width, int16_t height, uint8_t = 1) {
+        w = width;
+        h = height;
+        buffer.assign(w * h, 0);
+        return buffer.data();
+    }
+    bool created() { return !buffer.empty(); }
+    void* getPointer() { return buffer.data(); }
+    uint8_t getColorDepth() { return 16; }
+    int width() { return w; }
+    int height() { return h; }
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color) {
+        if (x >= 0 && y >= 0 && x < w && y < h) buffer[y * w + x] = (uint16_t)color;
+    }
+    void fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color) {
+        for (int j = y; j < y + rh; j++) {
+            for (int i = x; i < x + rw; i++) drawPixel(i, j, color);
+        }
+    }
+    void fillSprite(uint32_t color) { fillRect(0, 0, w, h, color); }
+    void drawRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color) {
+        fillRect(x, y, rw, 1, color);
+        fillRect(x, y + rh - 1, rw, 1, color);
+        fillRect(x, y, 1, rh, color);
+        fillRect(x + rw - 1, y, 1, rh, color);
+    }
+    void drawFastVLine(int32_t x, int32_t y, int32_t len, uint32_t color) { fillRect(x, y, 1, len, color); }
+    void drawCircle(int32_t x, int32_t y, int32_t r, uint32_t color) { drawRect(x - r, y - r, 2 * r, 2 * r, color); }
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color) { fillRect(x - r, y - r, 2 * r, 2 * r, color); }
+
+    // Text is a solid block 6 px per character, so overflowing text is visible in tests
+    void setTextDatum(uint8_t) {}
+    void setTextColor(uint16_t fg, uint16_t = 0) { textColor = fg; }
+    int16_t textWidth(const char* text) { return (int16_t)(strlen(text) * 6); }
+    int16_t drawString(const char* text, int32_t x, int32_t y) {
+        fillRect(x, y - 4, textWidth(text), 8, textColor);
+        return textWidth(text);
+    }
+
+    void pushSprite(int32_t x, int32_t y) { tft->pushImage(x, y, w, h, buffer.data()); }
+
+    TFT_eSPI* tft;
+    int w, h;
+    uint16_t textColor = 0;
+    std::vector<uint16_t> buffer;
+};
+
+#endif
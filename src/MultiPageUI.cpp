@@ -1,4 +1,5 @@
 #include "MultiPageUI.h"
+#include <new>
 
 namespace MultiPageUI {
 
@@ -63,6 +64,18 @@ ColorScheme* currentTheme = &defaultTheme;
 // Global page manager
 PageManager pageManager;
 
+// Global snapshot cache
+SnapshotCache snapshotCache;
+
+// Global icon cache
+IconCache iconCache;
+
+// Global render command queue
+RenderQueue renderQueue;
+
+// Global overlay layer
+Overlay overlay;
+
 // =============== Label Implementation ===============
 Label::Label(const char* initialText) {
     setText(initialText);
@@ -71,6 +84,7 @@ Label::Label(const char* initialText) {
 void Label::setText(const char* newText) {
     strncpy(text, newText, sizeof(text) - 1);
     text[sizeof(text) - 1] = '\0';
+    touch();
 }
 
 const char* Label::getText() const { 
@@ -94,6 +108,10 @@ WidgetType Label::getType() const {
     return W_LABEL; 
 }
 
+bool Label::tracksChanges() const {
+    return true;
+}
+
 // =============== Button Implementation ===============
 Button::Button(const char* initialText, void (*handler)()) : handler(handler) {
     setText(initialText);
@@ -102,6 +120,7 @@ Button::Button(const char* initialText, void (*handler)()) : handler(handler) {
 void Button::setText(const char* newText) {
     strncpy(text, newText, sizeof(text) - 1);
     text[sizeof(text) - 1] = '\0';
+    touch();
 }
 
 const char* Button::getText() const { 
@@ -128,6 +147,10 @@ WidgetType Button::getType() const {
     return W_BUTTON; 
 }
 
+bool Button::tracksChanges() const {
+    return true;
+}
+
 // =============== RadioButton Implementation ===============
 RadioButton::RadioButton(const char* text, bool selected) : text(text), selected(selected) {}
 
@@ -143,10 +166,12 @@ void RadioButton::draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focuse
 }
 
 void RadioButton::select() { 
+    if (!selected) touch();
     selected = true; 
 }
 
 void RadioButton::deselect() { 
+    if (selected) touch();
     selected = false; 
 }
 
@@ -158,6 +183,10 @@ WidgetType RadioButton::getType() const {
     return W_RADIO; 
 }
 
+bool RadioButton::tracksChanges() const {
+    return true;
+}
+
 // =============== CheckBox Implementation ===============
 CheckBox::CheckBox(const char* text, bool checked) : text(text), checked(checked) {}
 
@@ -174,6 +203,11 @@ void CheckBox::draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused)
 
 void CheckBox::toggle() { 
     checked = !checked; 
+    touch();
+}
+
+void CheckBox::setChecked(bool value) {
+    if (checked != value) toggle();
 }
 
 bool CheckBox::isChecked() const { 
@@ -184,6 +218,10 @@ WidgetType CheckBox::getType() const {
     return W_CHECKBOX; 
 }
 
+bool CheckBox::tracksChanges() const {
+    return true;
+}
+
 // =============== Link Implementation ===============
 Link::Link(const char* text, const char* route) : text(text), route(route) {}
 
@@ -213,17 +251,306 @@ WidgetType Link::getType() const {
     return W_LINK; 
 }
 
+bool Link::tracksChanges() const {
+    return true;
+}
+
 const char* Link::getRoute() const { 
     return route; 
 }
 
+// =============== Chart Implementation ===============
+Chart::Chart(float minValue, float maxValue, uint16_t samplesPerColumn) 
+    : minValue(minValue), maxValue(maxValue), samplesPerColumn(samplesPerColumn ? samplesPerColumn : 1),
+      samples(sampleStorage, SAMPLE_RING) {
+    clear();
+}
+
+void Chart::addSample(float value) {
+    foldSample(quantize(value));
+}
+
+bool Chart::postSample(float value) {
+    return samples.push(quantize(value));
+}
+
+void Chart::drainSamples() {
+    uint8_t q;
+    while (samples.pop(q)) {
+        foldSample(q);
+    }
+}
+
+void Chart::foldSample(uint8_t q) {
+    if (accCount == 0 || q < accMin) accMin = q;
+    if (accCount == 0 || q > accMax) accMax = q;
+    if (++accCount < samplesPerColumn) return;
+
+    // Column complete: push it into the ring
+    columnMin[head] = accMin;
+    columnMax[head] = accMax;
+    head = (head + 1) % MAX_COLUMNS;
+    if (filled < MAX_COLUMNS) filled++;
+    if (pending < MAX_COLUMNS) pending++;
+    accCount = 0;
+}
+
+void Chart::setRange(float newMin, float newMax) {
+    minValue = newMin;
+    maxValue = newMax;
+    clear();
+}
+
+void Chart::setSamplesPerColumn(uint16_t samples) {
+    samplesPerColumn = samples ? samples : 1;
+    accCount = 0;
+}
+
+void Chart::clear() {
+    drainSamples();
+    head = 0;
+    filled = 0;
+    pending = 0;
+    accCount = 0;
+    accMin = accMax = 0;
+    touch();
+}
+
+uint8_t Chart::quantize(float value) const {
+    if (maxValue <= minValue) return 0;
+    float t = (value - minValue) / (maxValue - minValue);
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    return (uint8_t)(t * 255.0f + 0.5f);
+}
+
+void Chart::drawColumns(TFT_eSprite &dst, int x, int y, int w, int h, int count) {
+    // Newest column goes at the right edge of the plot area
+    for (int i = 0; i < count && i < filled && i < w; i++) {
+        int column = (head - 1 - i + MAX_COLUMNS) % MAX_COLUMNS;
+        int top = y + (h - 1) - columnMax[column] * (h - 1) / 255;
+        int bottom = y + (h - 1) - columnMin[column] * (h - 1) / 255;
+        dst.drawFastVLine(x + w - 1 - i, top, bottom - top + 1, currentTheme->accent);
+    }
+}
+
+void Chart::draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused) {
+    drainSamples();
+    dst.drawRect(x, y, w, h, focused ? currentTheme->focusBackground : currentTheme->border);
+    drawColumns(dst, x + 1, y + 1, w - 2, h - 2, w - 2);
+    pending = 0;
+}
+
+bool Chart::update(TFT_eSprite &dst, int x, int y, int w, int h, bool) {
+    drainSamples();
+    int plotX = x + 1, plotY = y + 1, plotW = w - 2, plotH = h - 2;
+    int count = pending;
+    if (count == 0) return true;
+    pending = 0;
+
+    uint16_t* buffer = static_cast<uint16_t*>(dst.getPointer());
+    if (count >= plotW || dst.getColorDepth() != 16 || !buffer) {
+        dst.fillRect(plotX, plotY, plotW, plotH, currentTheme->background);
+        drawColumns(dst, plotX, plotY, plotW, plotH, plotW);
+        return true;
+    }
+
+    // Shift the existing plot left by the number of new columns, then draw only those
+    int stride = dst.width();
+    for (int row = plotY; row < plotY + plotH; row++) {
+        uint16_t* line = buffer + row * stride + plotX;
+        memmove(line, line + count, (plotW - count) * sizeof(uint16_t));
+    }
+    dst.fillRect(plotX + plotW - count, plotY, count, plotH, currentTheme->background);
+    drawColumns(dst, plotX, plotY, plotW, plotH, count);
+    return true;
+}
+
+bool Chart::hasPendingUpdate() const {
+    return pending > 0 || !samples.empty();
+}
+
+WidgetType Chart::getType() const { 
+    return W_CHART; 
+}
+
+bool Chart::tracksChanges() const {
+    return true;
+}
+
+// =============== Image Implementation ===============
+Image::Image(const ImageAsset* asset) : asset(asset) {}
+
+void Image::setAsset(const ImageAsset* newAsset) {
+    asset = newAsset;
+    touch();
+}
+
+const ImageAsset* Image::getAsset() const { 
+    return asset; 
+}
+
+// Sprite buffers hold 16-bit colors byte-swapped
+static inline uint16_t swapColor(uint16_t color) {
+    return (color >> 8) | (color << 8);
+}
+
+// Decode runs into dst (stride in pixels), skipping transparent pixels and anything outside the clip rect
+static void decodeImage(const ImageAsset* asset, uint16_t* dst, int stride, int x, int y,
+                        int clipX, int clipY, int clipW, int clipH, const uint16_t* palette) {
+    const uint8_t* pos = asset->data;
+    const uint8_t* end = asset->data + asset->length;
+    int col = 0, row = 0;
+
+    while (pos < end && row < asset->height && y + row < clipY + clipH) {
+        uint8_t token = *pos++;
+        int index = token >> 4;
+        int length = token & 0x0F;
+        if (length == 15 && pos < end) {
+            length = 16 + *pos++;
+        } else {
+            length += 1;
+        }
+
+        while (length > 0 && row < asset->height) {
+            int take = asset->width - col;
+            if (take > length) take = length;
+
+            int py = y + row;
+            if (index != asset->transparent && index < asset->paletteSize && py >= clipY) {
+                int from = x + col, to = x + col + take;
+                if (from < clipX) from = clipX;
+                if (to > clipX + clipW) to = clipX + clipW;
+                uint16_t color = palette[index];
+                uint16_t* out = dst + py * stride;
+                for (int px = from; px < to; px++) {
+                    out[px] = color;
+                }
+            }
+
+            col += take;
+            length -= take;
+            if (col == asset->width) {
+                col = 0;
+                row++;
+            }
+        }
+    }
+}
+
+void Image::draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused) {
+    uint16_t background = focused ? TFT_DARKGREY : currentTheme->background;
+    if (focused) dst.fillRect(x, y, w, h, background);
+    if (!asset) return;
+
+    uint16_t* buffer = static_cast<uint16_t*>(dst.getPointer());
+    if (!buffer || dst.getColorDepth() != 16) return;
+
+    // Center in the cell and clip to both the cell and the sprite
+    int ix = x + (w - asset->width) / 2;
+    int iy = y + (h - asset->height) / 2;
+    int clipX = x < 0 ? 0 : x;
+    int clipY = y < 0 ? 0 : y;
+    int clipW = (x + w > dst.width() ? dst.width() : x + w) - clipX;
+    int clipH = (y + h > dst.height() ? dst.height() : y + h) - clipY;
+    if (clipW <= 0 || clipH <= 0) return;
+    int stride = dst.width();
+
+    // Hot icons: copy already decoded rows
+    const uint16_t* cached = iconCache.find(asset, background);
+    if (!cached) {
+        uint16_t* slot = iconCache.insert(asset, background);
+        if (slot) {
+            uint16_t palette[16];
+            for (int i = 0; i < 16; i++) {
+                palette[i] = swapColor(i < asset->paletteSize ? asset->palette[i] : 0);
+            }
+            if (asset->transparent < 16) palette[asset->transparent] = swapColor(background);
+            ImageAsset opaque = *asset;
+            opaque.transparent = 0xFF;
+            decodeImage(&opaque, slot, asset->width, 0, 0, 0, 0, asset->width, asset->height, palette);
+            cached = slot;
+        }
+    }
+
+    if (cached) {
+        int from = ix < clipX ? clipX : ix;
+        int to = ix + asset->width > clipX + clipW ? clipX + clipW : ix + asset->width;
+        if (to <= from) return;
+        for (int row = 0; row < asset->height; row++) {
+            int py = iy + row;
+            if (py < clipY) continue;
+            if (py >= clipY + clipH) break;
+            memcpy(buffer + py * stride + from, cached + row * asset->width + (from - ix), (to - from) * sizeof(uint16_t));
+        }
+        return;
+    }
+
+    uint16_t palette[16];
+    for (int i = 0; i < asset->paletteSize && i < 16; i++) {
+        palette[i] = swapColor(asset->palette[i]);
+    }
+    decodeImage(asset, buffer, stride, ix, iy, clipX, clipY, clipW, clipH, palette);
+}
+
+WidgetType Image::getType() const { 
+    return W_IMAGE; 
+}
+
+bool Image::tracksChanges() const {
+    return true;
+}
+
+// =============== IconCache Implementation ===============
+IconCache::IconCache() : buffer(nullptr), capacity(0), used(0), count(0) {}
+
+void IconCache::begin(void* cacheBuffer, size_t size) {
+    buffer = static_cast<uint8_t*>(cacheBuffer);
+    capacity = size;
+    clear();
+}
+
+const uint16_t* IconCache::find(const ImageAsset* asset, uint16_t background) {
+    for (int i = 0; i < count; i++) {
+        if (entries[i].asset == asset && entries[i].background == background) {
+            return entries[i].pixels;
+        }
+    }
+    return nullptr;
+}
+
+// Reserve space for a decoded icon; when full, the whole cache starts over
+uint16_t* IconCache::insert(const ImageAsset* asset, uint16_t background) {
+    size_t bytes = (size_t)asset->width * asset->height * sizeof(uint16_t);
+    if (!buffer || bytes > capacity) return nullptr;
+    if (count >= MAX_ENTRIES || bytes > capacity - used) clear();
+
+    Entry& entry = entries[count++];
+    entry.asset = asset;
+    entry.background = background;
+    entry.pixels = reinterpret_cast<uint16_t*>(buffer + used);
+    used += (bytes + 3) & ~(size_t)3;
+    return entry.pixels;
+}
+
+void IconCache::clear() {
+    used = 0;
+    count = 0;
+}
+
+size_t IconCache::getBytesUsed() const {
+    return used;
+}
+
 // =============== Page Implementation ===============
 Page::Page(const char* pageName, Widget* grid[8][3], ColorScheme* theme) 
-    : scrollOffset(0), name(pageName) {
+    : scrollOffset(0), name(pageName), drawnSelRow(-1), drawnSelCol(-1), 
+      drawnScrollOffset(0), drawnTheme(nullptr), restorePending(false) {
     if (theme) currentTheme = theme;
     for (int r = 0; r < TOTAL_ROWS; r++) {
         for (int c = 0; c < COLS; c++) {
             widgets[r][c] = grid[r][c];
+            drawnRevision[r][c] = 0;
         }
     }
 }
@@ -237,8 +564,44 @@ const char* Page::getName() const {
 }
 
 void Page::draw(int selRow, int selCol) {
-    int cellW = (tft.width() - 2 * MARGIN - (COLS - 1) * GAP) / COLS;
-    int cellH = (tft.height() - 2 * MARGIN - (VISIBLE_ROWS - 1) * GAP) / VISIBLE_ROWS;
+    overlay.update();
+
+    // A widget that does not report its changes needs the full render below every frame
+    bool tracked = tracksChanges();
+
+    // First frame after navigation: start from the cached snapshot if it is still usable
+    if (restorePending) {
+        restorePending = false;
+        if (tracked && snapshotCache.restore(this)) {
+            redrawChangedCells(selRow, selCol, false);
+            recordDrawnState(selRow, selCol);
+            overlay.markRepainted();
+            overlay.compose(pageSprite);
+            pageManager.present();
+            return;
+        }
+    } else if (tracked && snapshotCache.getOwner() == this && drawnTheme == currentTheme &&
+               drawnScrollOffset == scrollOffset) {
+        // Sprite already holds this page: restore what a hidden overlay covered,
+        // then repaint and push only the cells that changed
+        int ux, uy, uw, uh;
+        bool uncovered = overlay.takeUncovered(ux, uy, uw, uh);
+        // Composing the overlay into changed cells clears its dirty flag, so read it first
+        bool pushOverlay = overlay.isDirty();
+        if (uncovered) repaintRect(ux, uy, uw, uh);
+
+        redrawChangedCells(selRow, selCol, true);
+        recordDrawnState(selRow, selCol);
+
+        if (pushOverlay || (uncovered && overlay.intersects(ux, uy, uw, uh))) {
+            int ox, oy, ow, oh;
+            overlay.compose(pageSprite);
+            overlay.getRect(ox, oy, ow, oh);
+            pushRect(ox, oy, ow, oh);
+        }
+        if (uncovered) pushRect(ux, uy, uw, uh);
+        return;
+    }
 
     pageSprite.fillSprite(currentTheme->background);
     drawScrollIndicator();
@@ -247,41 +610,178 @@ void Page::draw(int selRow, int selCol) {
         int actualRow = scrollOffset + visibleRow;
         if (actualRow >= TOTAL_ROWS) break;
 
-        bool isFullRow = (widgets[actualRow][0] != nullptr && widgets[actualRow][1] == nullptr && widgets[actualRow][2] == nullptr);
-
         for (int c = 0; c < COLS; c++) {
             Widget* w = widgets[actualRow][c];
             if (!w) continue;
 
             int x, y, w_w, h_h;
+            getCellRect(visibleRow, c, x, y, w_w, h_h);
+
+            bool focused = (actualRow == selRow && c == selCol);
+            w->draw(pageSprite, x, y, w_w, h_h, focused);
+        }
+    }
+    recordDrawnState(selRow, selCol);
+    overlay.markRepainted();
+    overlay.compose(pageSprite);
+    pageManager.present();
+}
 
-            y = MARGIN + visibleRow * (cellH + GAP);
-            h_h = cellH;
+void Page::getCellRect(int visibleRow, int col, int& x, int& y, int& w, int& h) {
+    int cellW = (tft.width() - 2 * MARGIN - (COLS - 1) * GAP) / COLS;
+    int cellH = (tft.height() - 2 * MARGIN - (VISIBLE_ROWS - 1) * GAP) / VISIBLE_ROWS;
+    int actualRow = scrollOffset + visibleRow;
 
-            if (isFullRow) {
-                x = MARGIN;
-                w_w = tft.width() - 2 * MARGIN;
-            } else {
-                x = MARGIN + c * (cellW + GAP);
-                w_w = cellW;
+    bool isFullRow = (widgets[actualRow][0] != nullptr && widgets[actualRow][1] == nullptr && widgets[actualRow][2] == nullptr);
+
+    y = MARGIN + visibleRow * (cellH + GAP);
+    h = cellH;
+
+    if (isFullRow) {
+        x = MARGIN;
+        w = tft.width() - 2 * MARGIN;
+    } else {
+        x = MARGIN + col * (cellW + GAP);
+        w = cellW;
+    }
+}
+
+void Page::redrawChangedCells(int selRow, int selCol, bool pushCells) {
+    bool focusMoved = (selRow != drawnSelRow || selCol != drawnSelCol);
+
+    for (int visibleRow = 0; visibleRow < VISIBLE_ROWS; visibleRow++) {
+        int actualRow = scrollOffset + visibleRow;
+        if (actualRow >= TOTAL_ROWS) break;
+
+        bool rowChanged = false;
+        for (int c = 0; c < COLS; c++) {
+            Widget* w = widgets[actualRow][c];
+            if (!w) continue;
+
+            bool wasFocused = (actualRow == drawnSelRow && c == drawnSelCol);
+            bool focused = (actualRow == selRow && c == selCol);
+            if (w->getRevision() != drawnRevision[actualRow][c] || (focusMoved && (wasFocused || focused))) {
+                rowChanged = true;
             }
+        }
+
+        // Text may overflow its cell, so a changed widget repaints the whole row band
+        if (rowChanged) {
+            int x, y, w_w, h_h;
+            getCellRect(visibleRow, 0, x, y, w_w, h_h);
+            repaintRow(visibleRow, selRow, selCol);
+            if (overlay.intersects(0, y, tft.width(), h_h)) overlay.compose(pageSprite);
+            if (pushCells) pushRect(0, y, tft.width(), h_h);
+            continue;
+        }
+
+        for (int c = 0; c < COLS; c++) {
+            Widget* w = widgets[actualRow][c];
+            if (!w || !w->hasPendingUpdate()) continue;
 
             bool focused = (actualRow == selRow && c == selCol);
-            w->draw(pageSprite, x, y, w_w, h_h, focused);
+            int x, y, w_w, h_h;
+            getCellRect(visibleRow, c, x, y, w_w, h_h);
+            // In-place updates would drag overlay pixels along, so covered cells are redrawn whole
+            bool covered = overlay.intersects(x, y, w_w, h_h);
+            if ((covered && overlay.isOnSprite()) || !w->update(pageSprite, x, y, w_w, h_h, focused)) {
+                pageSprite.fillRect(x, y, w_w, h_h, currentTheme->background);
+                w->draw(pageSprite, x, y, w_w, h_h, focused);
+            }
+            if (covered) overlay.compose(pageSprite);
+            if (pushCells) pushRect(x, y, w_w, h_h);
         }
     }
-    pageSprite.pushSprite(0, 0);
+}
+
+// Redraw one visible row across the full width, exactly as a full render would
+void Page::repaintRow(int visibleRow, int selRow, int selCol) {
+    int actualRow = scrollOffset + visibleRow;
+    int x, y, w_w, h_h;
+    getCellRect(visibleRow, 0, x, y, w_w, h_h);
+
+    pageSprite.fillRect(0, y, tft.width(), h_h, currentTheme->background);
+    drawScrollIndicatorBand(y, h_h);
+
+    for (int c = 0; c < COLS; c++) {
+        Widget* w = widgets[actualRow][c];
+        if (!w) continue;
+
+        getCellRect(visibleRow, c, x, y, w_w, h_h);
+        bool focused = (actualRow == selRow && c == selCol);
+        w->draw(pageSprite, x, y, w_w, h_h, focused);
+    }
+}
+
+// Repaint the page beneath a rectangle. Rows it touches are redrawn whole, as last
+// drawn; that leaves their pixels outside the rectangle unchanged, except for cells
+// whose pending in-place update the redraw consumed, which are pushed here.
+void Page::repaintRect(int rx, int ry, int rw, int rh) {
+    pageSprite.fillRect(rx, ry, rw, rh, currentTheme->background);
+    drawScrollIndicator();
+
+    for (int visibleRow = 0; visibleRow < VISIBLE_ROWS; visibleRow++) {
+        int actualRow = scrollOffset + visibleRow;
+        if (actualRow >= TOTAL_ROWS) break;
+
+        int x, y, w_w, h_h;
+        getCellRect(visibleRow, 0, x, y, w_w, h_h);
+        if (y >= ry + rh || y + h_h <= ry) continue;
+
+        bool pending[3] = { false, false, false };  // COLS
+        for (int c = 0; c < COLS; c++) {
+            pending[c] = widgets[actualRow][c] && widgets[actualRow][c]->hasPendingUpdate();
+        }
+        repaintRow(visibleRow, drawnSelRow, drawnSelCol);
+
+        for (int c = 0; c < COLS; c++) {
+            if (!pending[c]) continue;
+            getCellRect(visibleRow, c, x, y, w_w, h_h);
+            if (overlay.intersects(x, y, w_w, h_h)) overlay.compose(pageSprite);
+            pushRect(x, y, w_w, h_h);
+        }
+    }
+}
+
+void Page::recordDrawnState(int selRow, int selCol) {
+    for (int r = 0; r < TOTAL_ROWS; r++) {
+        for (int c = 0; c < COLS; c++) {
+            drawnRevision[r][c] = widgets[r][c] ? widgets[r][c]->getRevision() : 0;
+        }
+    }
+    drawnSelRow = selRow;
+    drawnSelCol = selCol;
+    drawnScrollOffset = scrollOffset;
+    drawnTheme = currentTheme;
+    snapshotCache.setOwner(this);
 }
 
 void Page::drawScrollIndicator() {
+    drawScrollIndicatorBand(0, tft.height());
+}
+
+// Fill the part of a rectangle that lies inside a horizontal band
+static void fillRectInBand(int x, int y, int w, int h, int bandY, int bandH, uint16_t color) {
+    int top = y > bandY ? y : bandY;
+    int bottom = (y + h < bandY + bandH) ? y + h : bandY + bandH;
+    if (bottom > top) pageSprite.fillRect(x, top, w, bottom - top, color);
+}
+
+// Draw only the rows of the scroll indicator that fall inside the band
+void Page::drawScrollIndicatorBand(int bandY, int bandH) {
     if (TOTAL_ROWS <= VISIBLE_ROWS) return; 
 
     int indicatorHeight = tft.height() - 2*MARGIN;
     int thumbHeight = (indicatorHeight * VISIBLE_ROWS) / TOTAL_ROWS;
     int thumbPos = (indicatorHeight - thumbHeight) * scrollOffset / (TOTAL_ROWS - VISIBLE_ROWS);
-
-    pageSprite.drawRect(tft.width() - 8, MARGIN, 6, indicatorHeight, TFT_DARKGREY);
-    pageSprite.fillRect(tft.width() - 8, MARGIN + thumbPos, 6, thumbHeight, currentTheme->border);
+    int x = tft.width() - 8;
+
+    // Outline (same pixels as drawRect), then the thumb
+    fillRectInBand(x, MARGIN, 6, 1, bandY, bandH, TFT_DARKGREY);
+    fillRectInBand(x, MARGIN + indicatorHeight - 1, 6, 1, bandY, bandH, TFT_DARKGREY);
+    fillRectInBand(x, MARGIN, 1, indicatorHeight, bandY, bandH, TFT_DARKGREY);
+    fillRectInBand(x + 5, MARGIN, 1, indicatorHeight, bandY, bandH, TFT_DARKGREY);
+    fillRectInBand(x, MARGIN + thumbPos, 6, thumbHeight, bandY, bandH, currentTheme->border);
 }
 
 Widget* Page::getWidget(int r, int c) { 
@@ -436,8 +936,33 @@ int Page::getScrollOffset() const {
     return scrollOffset; 
 }
 
+void Page::setScrollOffset(int offset) {
+    if (offset > TOTAL_ROWS - VISIBLE_ROWS) offset = TOTAL_ROWS - VISIBLE_ROWS;
+    if (offset < 0) offset = 0;
+    scrollOffset = offset;
+}
+
+void Page::prepareRestore() {
+    restorePending = true;
+}
+
+void Page::invalidate() {
+    drawnTheme = nullptr;
+}
+
+bool Page::tracksChanges() {
+    for (int r = 0; r < TOTAL_ROWS; r++) {
+        for (int c = 0; c < COLS; c++) {
+            if (widgets[r][c] && !widgets[r][c]->tracksChanges()) return false;
+        }
+    }
+    return true;
+}
+
 // =============== PageManager Implementation ===============
-PageManager::PageManager() : currentPageIndex(0), numPages(0) {}
+PageManager::PageManager() 
+    : currentPageIndex(0), numPages(0), transition(T_NONE), transitionSteps(8), 
+      transitionFrom(nullptr), transitionDirection(0) {}
 
 void PageManager::addPage(Page* page) {
     if (numPages < MAX_PAGES) {
@@ -446,15 +971,37 @@ void PageManager::addPage(Page* page) {
     }
 }
 
+void PageManager::removePage(Page* page) {
+    for (int i = 0; i < numPages; i++) {
+        if (pages[i] != page) continue;
+
+        bool wasCurrent = (i == currentPageIndex);
+        for (int j = i; j < numPages - 1; j++) {
+            pages[j] = pages[j + 1];
+        }
+        numPages--;
+        if (currentPageIndex > i || currentPageIndex >= numPages) {
+            currentPageIndex = currentPageIndex > 0 ? currentPageIndex - 1 : 0;
+        }
+        if (transitionFrom == page) transitionFrom = nullptr;
+
+        // Focus moves to the page that takes the removed one's place
+        if (wasCurrent && numPages > 0) {
+            resetSelection();
+            pages[currentPageIndex]->prepareRestore();
+        }
+
+        // The page's memory may be reused, so drop anything keyed by its address
+        snapshotCache.invalidate(page);
+        if (snapshotCache.getOwner() == page) snapshotCache.setOwner(nullptr);
+        return;
+    }
+}
+
 void PageManager::navigateToPage(const char* pageName) {
     for (int i = 0; i < numPages; i++) {
         if (strcmp(pages[i]->getName(), pageName) == 0) {
-            currentPageIndex = i;
-            selRow = findFirstValidRow();
-            selCol = pages[currentPageIndex]->findLeftmostInRow(selRow);
-            if (selCol == -1) {
-                selCol = 0;
-            }
+            showPage(i, i < currentPageIndex ? -1 : 1);
             Serial.print("Navigated to page: ");
             Serial.println(pageName);
             return;
@@ -466,12 +1013,7 @@ void PageManager::navigateToPage(const char* pageName) {
 
 void PageManager::goBack() {
     if (numPages > 1) {
-        currentPageIndex = (currentPageIndex + numPages - 1) % numPages;
-        selRow = findFirstValidRow();
-        selCol = pages[currentPageIndex]->findLeftmostInRow(selRow);
-        if (selCol == -1) {
-            selCol = 0;
-        }
+        showPage((currentPageIndex + numPages - 1) % numPages, -1);
         Serial.print("Went back to page: ");
         Serial.println(pages[currentPageIndex]->getName());
     }
@@ -479,12 +1021,7 @@ void PageManager::goBack() {
 
 void PageManager::goNext() {
     if (numPages > 1) {
-        currentPageIndex = (currentPageIndex + 1) % numPages;
-        selRow = findFirstValidRow();
-        selCol = pages[currentPageIndex]->findLeftmostInRow(selRow);
-        if (selCol == -1) {
-            selCol = 0;
-        }
+        showPage((currentPageIndex + 1) % numPages, 1);
         Serial.print("Went forward to page: ");
         Serial.println(pages[currentPageIndex]->getName());
     }
@@ -508,58 +1045,1363 @@ void PageManager::setTheme(ColorScheme* theme) {
     }
 }
 
-int PageManager::findFirstValidRow() {
-    Page* page = getCurrentPage();
-    if (!page) return 0;
-    
-    for (int r = 0; r < TOTAL_ROWS; r++) {
-        if (page->findLeftmostInRow(r) != -1) {
-            return r;
-        }
-    }
-    return 0;
+void PageManager::setTransition(TransitionStyle style, int steps) {
+    transition = style;
+    transitionSteps = steps > 0 ? steps : 1;
 }
 
-// =============== Utility Functions ===============
-void initDisplay() {
-    tft.init();
-    tft.setRotation(3);
-    tft.setTextColor(TFT_WHITE);
-    tft.setTextFont(2);
-    
-    pageSprite.createSprite(tft.width(), tft.height());
-    
-    pinMode(WIO_5S_UP, INPUT_PULLUP);
-    pinMode(WIO_5S_DOWN, INPUT_PULLUP);
-    pinMode(WIO_5S_LEFT, INPUT_PULLUP);
-    pinMode(WIO_5S_RIGHT, INPUT_PULLUP);
-    pinMode(WIO_5S_PRESS, INPUT_PULLUP);
+void PageManager::present() {
+    Page* from = transitionFrom;
+    transitionFrom = nullptr;
+
+    if (transition == T_SLIDE && from && from != getCurrentPage() &&
+        snapshotCache.slide(from, transitionDirection, transitionSteps)) {
+        return;
+    }
+    pageSprite.pushSprite(0, 0);
 }
 
-void handleInput() {
-    Page* currentPage = pageManager.getCurrentPage();
-    if (!currentPage) return;
+void PageManager::showPage(int index, int direction) {
+    Page* outgoing = getCurrentPage();
+    if (outgoing && !overlay.isOnSprite()) snapshotCache.store(outgoing);
 
-    if (digitalRead(WIO_5S_UP) == LOW) { 
-        currentPage->navigateUp(pageManager.selRow, pageManager.selCol); 
-        delay(150); 
-    }
-    if (digitalRead(WIO_5S_DOWN) == LOW) { 
-        currentPage->navigateDown(pageManager.selRow, pageManager.selCol); 
-        delay(150); 
+    currentPageIndex = index;
+    resetSelection();
+
+    pages[currentPageIndex]->prepareRestore();
+    transitionFrom = outgoing;
+    transitionDirection = direction;
+}
+
+// State format, version 1 (little endian):
+//   u16 magic, u8 version, u8 page count, u32 layout signature, u16 total length,
+//   u8 current page, u8 selRow, u8 selCol, u8 theme (0xFF = custom)
+//   per page: u8 scrollOffset, bitmap of CheckBox/RadioButton flags in grid order,
+//             then u8 length + bytes for every Label/Button text
+//   u16 CRC-16/CCITT over everything before it
+static const uint16_t STATE_MAGIC = 0x5549;
+static const uint8_t STATE_VERSION = 1;
+static const size_t STATE_HEADER = 14;
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
     }
-    if (digitalRead(WIO_5S_LEFT) == LOW) { 
-        currentPage->navigateLeft(pageManager.selRow, pageManager.selCol); 
-        delay(150); 
+    return hash;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
     }
-    if (digitalRead(WIO_5S_RIGHT) == LOW) { 
-        currentPage->navigateRight(pageManager.selRow, pageManager.selCol); 
-        delay(150); 
+    return crc;
+}
+
+static ColorScheme* const builtinThemes[] = { &defaultTheme, &redTheme, &blueTheme, &greenTheme };
+
+uint32_t PageManager::getLayoutSignature() {
+    uint32_t hash = 2166136261u;
+    hash = fnv1a(hash, &numPages, sizeof(numPages));
+    for (int i = 0; i < numPages; i++) {
+        hash = fnv1a(hash, pages[i]->getName(), strlen(pages[i]->getName()));
+        for (int r = 0; r < TOTAL_ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                Widget* w = pages[i]->getWidget(r, c);
+                uint8_t type = w ? (uint8_t)w->getType() : 0xFF;
+                hash = fnv1a(hash, &type, 1);
+            }
+        }
     }
+    return hash;
+}
 
-    if (digitalRead(WIO_5S_PRESS) == LOW) {
-        Widget* w = currentPage->getWidget(pageManager.selRow, pageManager.selCol);
-        if (w) {
+// Cheap fingerprint of everything saveState() covers, used to skip unchanged saves
+uint32_t PageManager::getStateStamp() {
+    uint32_t hash = 2166136261u;
+    int nav[3] = { currentPageIndex, selRow, selCol };
+    hash = fnv1a(hash, nav, sizeof(nav));
+    hash = fnv1a(hash, &currentTheme, sizeof(currentTheme));
+    for (int i = 0; i < numPages; i++) {
+        int scroll = pages[i]->getScrollOffset();
+        hash = fnv1a(hash, &scroll, sizeof(scroll));
+        for (int r = 0; r < TOTAL_ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                Widget* w = pages[i]->getWidget(r, c);
+                uint16_t revision = w ? w->getRevision() : 0;
+                hash = fnv1a(hash, &revision, sizeof(revision));
+            }
+        }
+    }
+    return hash;
+}
+
+size_t PageManager::saveState(uint8_t* buffer, size_t size) {
+    if (size < STATE_HEADER + 2) return 0;
+
+    uint32_t signature = getLayoutSignature();
+    uint8_t theme = 0xFF;
+    for (uint8_t t = 0; t < sizeof(builtinThemes) / sizeof(builtinThemes[0]); t++) {
+        if (builtinThemes[t] == currentTheme) theme = t;
+    }
+
+    buffer[0] = STATE_MAGIC & 0xFF;
+    buffer[1] = STATE_MAGIC >> 8;
+    buffer[2] = STATE_VERSION;
+    buffer[3] = (uint8_t)numPages;
+    memcpy(buffer + 4, &signature, sizeof(signature));
+    buffer[10] = (uint8_t)currentPageIndex;
+    buffer[11] = (uint8_t)selRow;
+    buffer[12] = (uint8_t)selCol;
+    buffer[13] = theme;
+    size_t pos = STATE_HEADER;
+
+    for (int i = 0; i < numPages; i++) {
+        Page* page = pages[i];
+        if (pos + 1 + (TOTAL_ROWS * COLS + 7) / 8 > size) return 0;
+        buffer[pos++] = (uint8_t)page->getScrollOffset();
+
+        // Boolean widget flags, packed
+        uint8_t bits = 0;
+        int bitCount = 0;
+        for (int r = 0; r < TOTAL_ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                Widget* w = page->getWidget(r, c);
+                if (!w || (w->getType() != W_CHECKBOX && w->getType() != W_RADIO)) continue;
+                bool flag = w->getType() == W_CHECKBOX ? static_cast<CheckBox*>(w)->isChecked()
+                                                       : static_cast<RadioButton*>(w)->isSelected();
+                if (flag) bits |= 1 << (bitCount % 8);
+                if (++bitCount % 8 == 0) {
+                    buffer[pos++] = bits;
+                    bits = 0;
+                }
+            }
+        }
+        if (bitCount % 8) buffer[pos++] = bits;
+
+        // Dynamic text
+        for (int r = 0; r < TOTAL_ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                Widget* w = page->getWidget(r, c);
+                if (!w || (w->getType() != W_LABEL && w->getType() != W_BUTTON)) continue;
+                const char* text = w->getType() == W_LABEL ? static_cast<Label*>(w)->getText()
+                                                           : static_cast<Button*>(w)->getText();
+                size_t length = strlen(text);
+                if (pos + 1 + length > size) return 0;
+                buffer[pos++] = (uint8_t)length;
+                memcpy(buffer + pos, text, length);
+                pos += length;
+            }
+        }
+    }
+
+    if (pos + 2 > size) return 0;
+    size_t total = pos + 2;
+    buffer[8] = total & 0xFF;
+    buffer[9] = total >> 8;
+    uint16_t crc = crc16(buffer, pos);
+    buffer[pos++] = crc & 0xFF;
+    buffer[pos++] = crc >> 8;
+    return pos;
+}
+
+bool PageManager::loadState(const uint8_t* buffer, size_t length) {
+    if (length < STATE_HEADER + 2) return false;
+
+    uint32_t signature;
+    memcpy(&signature, buffer + 4, sizeof(signature));
+    size_t total = buffer[8] | (buffer[9] << 8);
+    if ((buffer[0] | (buffer[1] << 8)) != STATE_MAGIC || buffer[2] != STATE_VERSION ||
+        buffer[3] != numPages || signature != getLayoutSignature() ||
+        total > length || total < STATE_HEADER + 2) {
+        return false;
+    }
+    size_t end = total - 2;
+    if (crc16(buffer, end) != (buffer[end] | (buffer[end + 1] << 8))) return false;
+    if (buffer[10] >= numPages || buffer[11] >= TOTAL_ROWS || buffer[12] >= COLS) return false;
+
+    // Walk the whole record once without touching any widget, so a malformed
+    // record is rejected before anything is applied
+    if (!applyState(buffer, end, false)) return false;
+    applyState(buffer, end, true);
+
+    if (buffer[13] < sizeof(builtinThemes) / sizeof(builtinThemes[0])) {
+        setTheme(builtinThemes[buffer[13]]);
+    }
+    currentPageIndex = buffer[10];
+    selRow = buffer[11];
+    selCol = buffer[12];
+    return true;
+}
+
+// Walks the per-page part of a state record; only writes to widgets when apply is set
+bool PageManager::applyState(const uint8_t* buffer, size_t end, bool apply) {
+    size_t pos = STATE_HEADER;
+    for (int i = 0; i < numPages; i++) {
+        Page* page = pages[i];
+        if (pos >= end) return false;
+        if (apply) page->setScrollOffset(buffer[pos]);
+        pos++;
+
+        int bitCount = 0;
+        for (int r = 0; r < TOTAL_ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                Widget* w = page->getWidget(r, c);
+                if (!w || (w->getType() != W_CHECKBOX && w->getType() != W_RADIO)) continue;
+                if (pos + bitCount / 8 >= end) return false;
+                bool flag = buffer[pos + bitCount / 8] & (1 << (bitCount % 8));
+                bitCount++;
+                if (!apply) continue;
+                if (w->getType() == W_CHECKBOX) {
+                    static_cast<CheckBox*>(w)->setChecked(flag);
+                } else if (flag) {
+                    static_cast<RadioButton*>(w)->select();
+                } else {
+                    static_cast<RadioButton*>(w)->deselect();
+                }
+            }
+        }
+        pos += (bitCount + 7) / 8;
+
+        for (int r = 0; r < TOTAL_ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                Widget* w = page->getWidget(r, c);
+                if (!w || (w->getType() != W_LABEL && w->getType() != W_BUTTON)) continue;
+                if (pos >= end || pos + 1 + buffer[pos] > end) return false;
+                size_t stored = buffer[pos];
+                if (apply) {
+                    char text[32];
+                    size_t textLength = stored < sizeof(text) - 1 ? stored : sizeof(text) - 1;
+                    memcpy(text, buffer + pos + 1, textLength);
+                    text[textLength] = '\0';
+                    if (w->getType() == W_LABEL) {
+                        static_cast<Label*>(w)->setText(text);
+                    } else {
+                        static_cast<Button*>(w)->setText(text);
+                    }
+                }
+                pos += 1 + stored;
+            }
+        }
+    }
+    return pos == end;
+}
+
+void PageManager::resetSelection() {
+    selRow = findFirstValidRow();
+    selCol = pages[currentPageIndex]->findLeftmostInRow(selRow);
+    if (selCol == -1) {
+        selCol = 0;
+    }
+}
+
+int PageManager::findFirstValidRow() {
+    Page* page = getCurrentPage();
+    if (!page) return 0;
+    
+    for (int r = 0; r < TOTAL_ROWS; r++) {
+        if (page->findLeftmostInRow(r) != -1) {
+            return r;
+        }
+    }
+    return 0;
+}
+
+// =============== SnapshotCache Implementation ===============
+// Snapshots are stored as a stream of palette-indexed runs over the whole frame.
+// Each run is one byte: high nibble = palette index, low nibble = length - 1.
+// A low nibble of 15 means the length is 16 + the following byte.
+
+SnapshotCache::SnapshotCache() 
+    : count(0), used(0), useCounter(0), skipped(0), owner(nullptr), pool(nullptr), capacity(0), line(nullptr) {}
+
+void SnapshotCache::begin(void* buffer, size_t size) {
+    clear();
+    pool = nullptr;
+    capacity = 0;
+    line = nullptr;
+
+    // Align for the row buffer, then keep the rest for snapshots
+    uintptr_t address = reinterpret_cast<uintptr_t>(buffer);
+    size_t padding = (alignof(uint16_t) - address % alignof(uint16_t)) % alignof(uint16_t);
+    size_t lineBytes = MAX_LINE * sizeof(uint16_t);
+    if (!buffer || size <= padding + lineBytes) return;
+
+    line = reinterpret_cast<uint16_t*>(static_cast<uint8_t*>(buffer) + padding);
+    pool = static_cast<uint8_t*>(buffer) + padding + lineBytes;
+    capacity = size - padding - lineBytes;
+}
+
+bool SnapshotCache::store(Page* page) {
+    if (!pool) return false;
+    // The sprite must still hold the last frame rendered for this page
+    if (owner != page || !pageSprite.created() || pageSprite.getColorDepth() != 16) return false;
+
+    int existing = find(page);
+    if (existing >= 0) remove(existing);
+    if (count >= MAX_SLOTS) evictOldest(page);
+
+    const uint16_t* px = static_cast<const uint16_t*>(pageSprite.getPointer());
+    uint32_t pixels = (uint32_t)pageSprite.width() * pageSprite.height();
+
+    Snapshot snap;
+    while (true) {
+        long length = encode(px, pixels, snap, pool + used, capacity - used);
+        if (length < 0) {
+            skipped++;  // Too many colors for the palette
+            return false;
+        }
+        if (length > 0) {
+            snap.length = (size_t)length;
+            break;
+        }
+        if (!evictOldest(page)) {
+            skipped++;  // Page does not fit even in an empty pool
+            return false;
+        }
+    }
+
+    snap.page = page;
+    snap.theme = currentTheme;
+    snap.scrollOffset = page->scrollOffset;
+    snap.selRow = page->drawnSelRow;
+    snap.selCol = page->drawnSelCol;
+    memcpy(snap.revision, page->drawnRevision, sizeof(snap.revision));
+    snap.pixels = pixels;
+    snap.offset = used;
+    snap.lastUse = ++useCounter;
+
+    slots[count++] = snap;
+    used += snap.length;
+    return true;
+}
+
+bool SnapshotCache::restore(Page* page) {
+    int index = find(page);
+    if (index < 0) return false;
+
+    Snapshot& snap = slots[index];
+    uint32_t pixels = (uint32_t)pageSprite.width() * pageSprite.height();
+    if (snap.theme != currentTheme || snap.scrollOffset != page->scrollOffset || snap.pixels != pixels ||
+        !pageSprite.created() || pageSprite.getColorDepth() != 16) {
+        remove(index);
+        return false;
+    }
+
+    RunReader reader = { pool + snap.offset, pool + snap.offset + snap.length, snap.palette, 0, 0 };
+    reader.fill(static_cast<uint16_t*>(pageSprite.getPointer()), pixels);
+
+    memcpy(page->drawnRevision, snap.revision, sizeof(snap.revision));
+    page->drawnSelRow = snap.selRow;
+    page->drawnSelCol = snap.selCol;
+    snap.lastUse = ++useCounter;
+    owner = page;
+    return true;
+}
+
+bool SnapshotCache::slide(Page* from, int direction, int steps) {
+    int index = find(from);
+    if (index < 0) return false;
+
+    Snapshot& snap = slots[index];
+    int width = pageSprite.width();
+    int height = pageSprite.height();
+    if (!line || width > MAX_LINE || snap.pixels != (uint32_t)width * height) return false;
+
+    uint16_t* incoming = static_cast<uint16_t*>(pageSprite.getPointer());
+    bool oldSwapBytes = tft.getSwapBytes();
+    tft.setSwapBytes(false);
+
+    // Outgoing rows are decoded on the fly; incoming rows come straight from the sprite
+    for (int step = 1; step <= steps; step++) {
+        int offset = width * step / steps;
+        RunReader reader = { pool + snap.offset, pool + snap.offset + snap.length, snap.palette, 0, 0 };
+
+        tft.startWrite();
+        for (int y = 0; y < height; y++) {
+            reader.fill(line, width);
+            uint16_t* row = incoming + y * width;
+            if (direction >= 0) {
+                if (offset < width) tft.pushImage(0, y, width - offset, 1, line + offset);
+                tft.pushImage(width - offset, y, offset, 1, row);
+            } else {
+                tft.pushImage(0, y, offset, 1, row + width - offset);
+                if (offset < width) tft.pushImage(offset, y, width - offset, 1, line);
+            }
+        }
+        tft.endWrite();
+    }
+
+    tft.setSwapBytes(oldSwapBytes);
+    snap.lastUse = ++useCounter;
+    return true;
+}
+
+void SnapshotCache::invalidate(Page* page) {
+    int index = find(page);
+    if (index >= 0) remove(index);
+}
+
+void SnapshotCache::clear() {
+    count = 0;
+    used = 0;
+}
+
+void SnapshotCache::setOwner(Page* page) {
+    owner = page;
+}
+
+Page* SnapshotCache::getOwner() const {
+    return owner;
+}
+
+size_t SnapshotCache::getBytesUsed() const {
+    return used;
+}
+
+int SnapshotCache::getCount() const {
+    return count;
+}
+
+uint32_t SnapshotCache::getSkipped() const {
+    return skipped;
+}
+
+int SnapshotCache::find(Page* page) {
+    for (int i = 0; i < count; i++) {
+        if (slots[i].page == page) return i;
+    }
+    return -1;
+}
+
+void SnapshotCache::remove(int index) {
+    size_t offset = slots[index].offset;
+    size_t length = slots[index].length;
+
+    // Compact the pool so free space always stays at the end
+    memmove(pool + offset, pool + offset + length, used - offset - length);
+    used -= length;
+
+    for (int i = index; i < count - 1; i++) {
+        slots[i] = slots[i + 1];
+    }
+    count--;
+
+    for (int i = 0; i < count; i++) {
+        if (slots[i].offset > offset) slots[i].offset -= length;
+    }
+}
+
+bool SnapshotCache::evictOldest(Page* keep) {
+    int oldest = -1;
+    for (int i = 0; i < count; i++) {
+        if (slots[i].page == keep) continue;
+        if (oldest == -1 || slots[i].lastUse < slots[oldest].lastUse) oldest = i;
+    }
+    if (oldest == -1) return false;
+    remove(oldest);
+    return true;
+}
+
+long SnapshotCache::encode(const uint16_t* px, size_t pixels, Snapshot& snap, uint8_t* out, size_t capacity) {
+    size_t length = 0;
+    snap.paletteSize = 0;
+
+    size_t i = 0;
+    while (i < pixels) {
+        uint16_t color = px[i];
+        size_t run = 1;
+        while (i + run < pixels && px[i + run] == color && run < 16 + 255) run++;
+
+        int index = -1;
+        for (int p = 0; p < snap.paletteSize; p++) {
+            if (snap.palette[p] == color) {
+                index = p;
+                break;
+            }
+        }
+        if (index == -1) {
+            if (snap.paletteSize >= MAX_PALETTE) return -1;
+            index = snap.paletteSize++;
+            snap.palette[index] = color;
+        }
+
+        if (run < 16) {
+            if (length + 1 > capacity) return 0;
+            out[length++] = (uint8_t)((index << 4) | (run - 1));
+        } else {
+            if (length + 2 > capacity) return 0;
+            out[length++] = (uint8_t)((index << 4) | 15);
+            out[length++] = (uint8_t)(run - 16);
+        }
+        i += run;
+    }
+    return (long)length;
+}
+
+void SnapshotCache::RunReader::fill(uint16_t* dst, int count) {
+    while (count > 0) {
+        if (remaining == 0) {
+            if (pos >= end) return;
+            uint8_t token = *pos++;
+            int length = token & 0x0F;
+            if (length == 15 && pos < end) {
+                length = 16 + *pos++;
+            } else {
+                length += 1;
+            }
+            color = palette[token >> 4];
+            remaining = length;
+        }
+        int take = remaining < count ? remaining : count;
+        for (int i = 0; i < take; i++) {
+            *dst++ = color;
+        }
+        remaining -= take;
+        count -= take;
+    }
+}
+
+// =============== Arena Implementation ===============
+// The start is rounded up to ALIGN, so an unaligned buffer loses up to ALIGN - 1 bytes
+Arena::Arena(void* buffer, size_t size) 
+    : buffer(static_cast<uint8_t*>(buffer)), capacity(size), used(0), peak(0) {
+    size_t padding = (ALIGN - reinterpret_cast<uintptr_t>(buffer) % ALIGN) % ALIGN;
+    if (padding > capacity) padding = capacity;
+    this->buffer += padding;
+    capacity -= padding;
+}
+
+void* Arena::allocate(size_t size) {
+    size = (size + ALIGN - 1) / ALIGN * ALIGN;
+    if (size > capacity - used) return nullptr;
+
+    void* ptr = buffer + used;
+    used += size;
+    if (used > peak) peak = used;
+    return ptr;
+}
+
+const char* Arena::copyString(const char* str) {
+    size_t length = strlen(str);
+    char* copy = static_cast<char*>(allocate(length + 1));
+    if (copy) memcpy(copy, str, length + 1);
+    return copy;
+}
+
+size_t Arena::mark() const {
+    return used;
+}
+
+// Objects in the released range are not destroyed; widgets and pages own no resources
+void Arena::reset(size_t mark) {
+    if (mark < used) used = mark;
+}
+
+size_t Arena::getUsed() const {
+    return used;
+}
+
+size_t Arena::getPeak() const {
+    return peak;
+}
+
+size_t Arena::getCapacity() const {
+    return capacity;
+}
+
+// =============== PageBuilder Implementation ===============
+PageBuilder::PageBuilder(Arena& arena, const char* pageName) : arena(arena), failed(false) {
+    name = arena.copyString(pageName);
+    if (!name) failed = true;
+    for (int r = 0; r < TOTAL_ROWS; r++) {
+        for (int c = 0; c < COLS; c++) {
+            grid[r][c] = nullptr;
+        }
+    }
+}
+
+void* PageBuilder::allocateCell(int row, int col, size_t size) {
+    if (row < 0 || row >= TOTAL_ROWS || col < 0 || col >= COLS || grid[row][col]) {
+        failed = true;
+        return nullptr;
+    }
+    void* ptr = arena.allocate(size);
+    if (!ptr) failed = true;
+    return ptr;
+}
+
+Label* PageBuilder::addLabel(int row, int col, const char* text) {
+    void* ptr = allocateCell(row, col, sizeof(Label));
+    if (!ptr) return nullptr;
+    Label* label = new (ptr) Label(text);
+    grid[row][col] = label;
+    return label;
+}
+
+Button* PageBuilder::addButton(int row, int col, const char* text, void (*handler)()) {
+    void* ptr = allocateCell(row, col, sizeof(Button));
+    if (!ptr) return nullptr;
+    Button* button = new (ptr) Button(text, handler);
+    grid[row][col] = button;
+    return button;
+}
+
+RadioButton* PageBuilder::addRadio(int row, int col, const char* text, bool selected) {
+    void* ptr = allocateCell(row, col, sizeof(RadioButton));
+    const char* copy = ptr ? arena.copyString(text) : nullptr;
+    if (!copy) {
+        failed = true;
+        return nullptr;
+    }
+    RadioButton* radio = new (ptr) RadioButton(copy, selected);
+    grid[row][col] = radio;
+    return radio;
+}
+
+CheckBox* PageBuilder::addCheckBox(int row, int col, const char* text, bool checked) {
+    void* ptr = allocateCell(row, col, sizeof(CheckBox));
+    const char* copy = ptr ? arena.copyString(text) : nullptr;
+    if (!copy) {
+        failed = true;
+        return nullptr;
+    }
+    CheckBox* checkBox = new (ptr) CheckBox(copy, checked);
+    grid[row][col] = checkBox;
+    return checkBox;
+}
+
+Link* PageBuilder::addLink(int row, int col, const char* text, const char* route) {
+    void* ptr = allocateCell(row, col, sizeof(Link));
+    const char* textCopy = ptr ? arena.copyString(text) : nullptr;
+    const char* routeCopy = textCopy ? arena.copyString(route) : nullptr;
+    if (!routeCopy) {
+        failed = true;
+        return nullptr;
+    }
+    Link* link = new (ptr) Link(textCopy, routeCopy);
+    grid[row][col] = link;
+    return link;
+}
+
+Chart* PageBuilder::addChart(int row, int col, float minValue, float maxValue, uint16_t samplesPerColumn) {
+    void* ptr = allocateCell(row, col, sizeof(Chart));
+    if (!ptr) return nullptr;
+    Chart* chart = new (ptr) Chart(minValue, maxValue, samplesPerColumn);
+    grid[row][col] = chart;
+    return chart;
+}
+
+Image* PageBuilder::addImage(int row, int col, const ImageAsset* asset) {
+    void* ptr = allocateCell(row, col, sizeof(Image));
+    if (!ptr) return nullptr;
+    Image* image = new (ptr) Image(asset);
+    grid[row][col] = image;
+    return image;
+}
+
+Page* PageBuilder::build(ColorScheme* theme) {
+    void* ptr = failed ? nullptr : arena.allocate(sizeof(Page));
+    if (!ptr) {
+        Serial.print("PageBuilder failed: ");
+        Serial.println(name ? name : "(no name)");
+        return nullptr;
+    }
+    return new (ptr) Page(name, grid, theme);
+}
+
+// =============== RenderQueue Implementation ===============
+RenderQueue::RenderQueue() : events(eventStorage, MAX_EVENTS), enabled(false), dropped(0) {}
+
+// Call before the render task starts; the buffer holds count - 1 pending commands
+void RenderQueue::enable(UICommand* buffer, size_t count) {
+    commands.begin(buffer, count);
+    enabled.store(buffer != nullptr && count > 1);
+}
+
+void RenderQueue::disable() {
+    enabled.store(false);
+}
+
+bool RenderQueue::isEnabled() const {
+    return enabled.load();
+}
+
+bool RenderQueue::post(UICommand& command) {
+    if (commands.push(command)) return true;
+    dropped.fetch_add(1);
+    return false;
+}
+
+bool RenderQueue::setText(Label* label, const char* text) {
+    UICommand command = {};
+    command.type = CMD_SET_LABEL_TEXT;
+    command.target = label;
+    strncpy(command.text, text, sizeof(command.text) - 1);
+    return post(command);
+}
+
+bool RenderQueue::setText(Button* button, const char* text) {
+    UICommand command = {};
+    command.type = CMD_SET_BUTTON_TEXT;
+    command.target = button;
+    strncpy(command.text, text, sizeof(command.text) - 1);
+    return post(command);
+}
+
+bool RenderQueue::toggle(CheckBox* checkBox) {
+    UICommand command = {};
+    command.type = CMD_TOGGLE;
+    command.target = checkBox;
+    return post(command);
+}
+
+bool RenderQueue::selectRadio(Page* page, int row, RadioButton* radio) {
+    UICommand command = {};
+    command.type = CMD_SELECT_RADIO;
+    command.target = radio;
+    command.page = page;
+    command.row = row;
+    return post(command);
+}
+
+bool RenderQueue::navigateToPage(const char* pageName) {
+    UICommand command = {};
+    command.type = CMD_NAVIGATE;
+    strncpy(command.text, pageName, sizeof(command.text) - 1);
+    return post(command);
+}
+
+bool RenderQueue::goBack() {
+    UICommand command = {};
+    command.type = CMD_BACK;
+    return post(command);
+}
+
+bool RenderQueue::goNext() {
+    UICommand command = {};
+    command.type = CMD_NEXT;
+    return post(command);
+}
+
+bool RenderQueue::setTheme(ColorScheme* theme) {
+    UICommand command = {};
+    command.type = CMD_SET_THEME;
+    command.theme = theme;
+    return post(command);
+}
+
+bool RenderQueue::moveFocus(CommandType direction) {
+    UICommand command = {};
+    command.type = direction;
+    return post(command);
+}
+
+bool RenderQueue::press() {
+    UICommand command = {};
+    command.type = CMD_PRESS;
+    return post(command);
+}
+
+// Samples bypass the command ring and go to the chart's own sample ring
+bool RenderQueue::addSample(Chart* chart, float value) {
+    if (chart->postSample(value)) return true;
+    dropped.fetch_add(1);
+    return false;
+}
+
+bool RenderQueue::showToast(const char* text, uint32_t durationMs) {
+    UICommand command = {};
+    command.type = CMD_SHOW_TOAST;
+    command.durationMs = durationMs;
+    strncpy(command.text, text, sizeof(command.text) - 1);
+    return post(command);
+}
+
+// Options must outlive the overlay; the handler runs from dispatchEvents()
+bool RenderQueue::showDialog(const char* message, const char* const* options, int count, void (*handler)(int)) {
+    return postOverlay(CMD_SHOW_DIALOG, message, options, count, handler);
+}
+
+bool RenderQueue::showMenu(const char* title, const char* const* options, int count, void (*handler)(int)) {
+    return postOverlay(CMD_SHOW_MENU, title, options, count, handler);
+}
+
+bool RenderQueue::postOverlay(CommandType type, const char* text, const char* const* options, int count, void (*handler)(int)) {
+    UICommand command = {};
+    command.type = type;
+    strncpy(command.text, text, sizeof(command.text) - 1);
+    command.options = options;
+    command.optionCount = count;
+    command.handler = handler;
+    return post(command);
+}
+
+bool RenderQueue::dismissOverlay() {
+    UICommand command = {};
+    command.type = CMD_DISMISS_OVERLAY;
+    return post(command);
+}
+
+// Run handlers of buttons pressed and overlay options chosen on the render side;
+// call from the app task
+int RenderQueue::dispatchEvents() {
+    int count = 0;
+    UIEvent event;
+    while (events.pop(event)) {
+        if (event.button) {
+            event.button->onPress();
+        } else {
+            event.handler(event.choice);
+        }
+        count++;
+    }
+    return count;
+}
+
+bool RenderQueue::postEvent(const UIEvent& event) {
+    if (events.push(event)) return true;
+    dropped.fetch_add(1);
+    return false;
+}
+
+uint32_t RenderQueue::getDropped() const {
+    return dropped.load();
+}
+
+// Applies the commands queued when the call starts; later ones wait for the next
+// frame, so a producer that keeps posting cannot hold off drawing
+int RenderQueue::applyPending() {
+    size_t batch = commands.size();
+    int count = 0;
+    UICommand command;
+    while ((size_t)count < batch && commands.pop(command)) {
+        apply(command);
+        count++;
+    }
+    return count;
+}
+
+void RenderQueue::renderFrame() {
+    applyPending();
+    Page* page = pageManager.getCurrentPage();
+    if (page) {
+        page->draw(pageManager.selRow, pageManager.selCol);
+    }
+}
+
+void RenderQueue::apply(const UICommand& command) {
+    Page* page = pageManager.getCurrentPage();
+
+    // A modal overlay captures focus movement and presses
+    if (overlay.isModal()) {
+        if (command.type == CMD_PRESS) {
+            UIEvent event = {};
+            if (overlay.choose(event.choice, event.handler) && event.handler) postEvent(event);
+            return;
+        }
+        if (command.type >= CMD_MOVE_UP && command.type <= CMD_MOVE_RIGHT) {
+            overlay.navigate(command.type);
+            return;
+        }
+    }
+
+    switch (command.type) {
+        case CMD_SET_LABEL_TEXT:
+            static_cast<Label*>(command.target)->setText(command.text);
+            break;
+        case CMD_SET_BUTTON_TEXT:
+            static_cast<Button*>(command.target)->setText(command.text);
+            break;
+        case CMD_TOGGLE:
+            static_cast<CheckBox*>(command.target)->toggle();
+            break;
+        case CMD_SELECT_RADIO:
+            command.page->selectRadioInRow(command.row, static_cast<RadioButton*>(command.target));
+            break;
+        case CMD_NAVIGATE:
+            pageManager.navigateToPage(command.text);
+            break;
+        case CMD_BACK:
+            pageManager.goBack();
+            break;
+        case CMD_NEXT:
+            pageManager.goNext();
+            break;
+        case CMD_SET_THEME:
+            pageManager.setTheme(command.theme);
+            break;
+        case CMD_MOVE_UP:
+            if (page) page->navigateUp(pageManager.selRow, pageManager.selCol);
+            break;
+        case CMD_MOVE_DOWN:
+            if (page) page->navigateDown(pageManager.selRow, pageManager.selCol);
+            break;
+        case CMD_MOVE_LEFT:
+            if (page) page->navigateLeft(pageManager.selRow, pageManager.selCol);
+            break;
+        case CMD_MOVE_RIGHT:
+            if (page) page->navigateRight(pageManager.selRow, pageManager.selCol);
+            break;
+        case CMD_PRESS: {
+            Widget* w = page ? page->getWidget(pageManager.selRow, pageManager.selCol) : nullptr;
+            if (!w) break;
+            switch (w->getType()) {
+                case W_RADIO:
+                    page->selectRadioInRow(pageManager.selRow, static_cast<RadioButton*>(w));
+                    break;
+                case W_CHECKBOX:
+                    static_cast<CheckBox*>(w)->toggle();
+                    break;
+                case W_BUTTON: {
+                    UIEvent event = {};
+                    event.button = static_cast<Button*>(w);
+                    postEvent(event);
+                    break;
+                }
+                default:
+                    w->onPress();
+                    break;
+            }
+            break;
+        }
+        case CMD_SHOW_TOAST:
+            overlay.showToast(command.text, command.durationMs);
+            break;
+        case CMD_SHOW_DIALOG:
+            overlay.showDialog(command.text, command.options, command.optionCount, command.handler);
+            break;
+        case CMD_SHOW_MENU:
+            overlay.showMenu(command.text, command.options, command.optionCount, command.handler);
+            break;
+        case CMD_DISMISS_OVERLAY:
+            overlay.dismiss();
+            break;
+    }
+}
+
+// =============== Overlay Implementation ===============
+static const int OVERLAY_LINE = 24;
+
+Overlay::Overlay() 
+    : kind(OV_NONE), options(nullptr), optionCount(0), focus(0), handler(nullptr), expiresAt(0),
+      x(0), y(0), w(0), h(0), dirty(false), onSprite(false), uncovered(false),
+      uncoveredX(0), uncoveredY(0), uncoveredW(0), uncoveredH(0) {
+    text[0] = '\0';
+}
+
+void Overlay::showToast(const char* message, uint32_t durationMs) {
+    open(OV_TOAST, message, nullptr, 0, nullptr);
+    expiresAt = millis() + durationMs;
+}
+
+void Overlay::showDialog(const char* message, const char* const* dialogOptions, int count, void (*dialogHandler)(int)) {
+    open(OV_DIALOG, message, dialogOptions, count, dialogHandler);
+}
+
+void Overlay::showMenu(const char* title, const char* const* menuOptions, int count, void (*menuHandler)(int)) {
+    open(OV_MENU, title, menuOptions, count, menuHandler);
+}
+
+void Overlay::open(Kind newKind, const char* newText, const char* const* newOptions, int count, void (*newHandler)(int)) {
+    uncover();
+    kind = newKind;
+    strncpy(text, newText, sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    options = newOptions;
+    optionCount = newOptions ? count : 0;
+    focus = 0;
+    handler = newHandler;
+    layout();
+    dirty = true;
+}
+
+void Overlay::dismiss() {
+    uncover();
+    kind = OV_NONE;
+    dirty = false;
+}
+
+// Remember the area the overlay occupied so the page beneath can be repainted
+void Overlay::uncover() {
+    if (kind == OV_NONE || !onSprite) return;
+
+    if (!uncovered) {
+        uncoveredX = x;
+        uncoveredY = y;
+        uncoveredW = w;
+        uncoveredH = h;
+        uncovered = true;
+        return;
+    }
+    int right = (uncoveredX + uncoveredW > x + w) ? uncoveredX + uncoveredW : x + w;
+    int bottom = (uncoveredY + uncoveredH > y + h) ? uncoveredY + uncoveredH : y + h;
+    if (x < uncoveredX) uncoveredX = x;
+    if (y < uncoveredY) uncoveredY = y;
+    uncoveredW = right - uncoveredX;
+    uncoveredH = bottom - uncoveredY;
+}
+
+void Overlay::layout() {
+    int screenW = pageSprite.width();
+    int screenH = pageSprite.height();
+
+    switch (kind) {
+        case OV_TOAST:
+            w = pageSprite.textWidth(text) + 2 * MARGIN;
+            h = OVERLAY_LINE + GAP;
+            x = (screenW - w) / 2;
+            y = screenH - h - MARGIN;
+            break;
+        case OV_DIALOG:
+            w = screenW * 3 / 4;
+            h = 2 * OVERLAY_LINE + 3 * GAP;
+            x = (screenW - w) / 2;
+            y = (screenH - h) / 2;
+            break;
+        case OV_MENU:
+            w = screenW / 2;
+            h = (optionCount + 1) * OVERLAY_LINE + 2 * GAP;
+            x = (screenW - w) / 2;
+            y = (screenH - h) / 2;
+            break;
+        default:
+            w = h = 0;
+            break;
+    }
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (w > screenW) w = screenW;
+    if (h > screenH) h = screenH;
+}
+
+bool Overlay::isVisible() const {
+    return kind != OV_NONE;
+}
+
+bool Overlay::isModal() const {
+    return kind == OV_DIALOG || kind == OV_MENU;
+}
+
+bool Overlay::handleInput() {
+    if (!isModal()) return false;
+
+    if (digitalRead(WIO_5S_UP) == LOW) { navigate(CMD_MOVE_UP); delay(150); }
+    if (digitalRead(WIO_5S_DOWN) == LOW) { navigate(CMD_MOVE_DOWN); delay(150); }
+    if (digitalRead(WIO_5S_LEFT) == LOW) { navigate(CMD_MOVE_LEFT); delay(150); }
+    if (digitalRead(WIO_5S_RIGHT) == LOW) { navigate(CMD_MOVE_RIGHT); delay(150); }
+    if (digitalRead(WIO_5S_PRESS) == LOW) { press(); delay(200); }
+    return true;
+}
+
+bool Overlay::navigate(CommandType direction) {
+    if (!isModal() || optionCount == 0) return false;
+
+    bool previous = (direction == CMD_MOVE_UP || direction == CMD_MOVE_LEFT);
+    focus = (focus + (previous ? optionCount - 1 : 1)) % optionCount;
+    dirty = true;
+    return true;
+}
+
+bool Overlay::press() {
+    int choice;
+    void (*callback)(int);
+    if (!choose(choice, callback)) return false;
+
+    // Closed first so the handler may open another overlay
+    if (callback) callback(choice);
+    return true;
+}
+
+// Closes a dialog or menu and hands back its handler and the focused option
+// (-1 if it has none) without running it
+bool Overlay::choose(int& choice, void (*&callback)(int)) {
+    if (!isModal()) return false;
+
+    choice = optionCount ? focus : -1;
+    callback = handler;
+    dismiss();
+    return true;
+}
+
+void Overlay::update() {
+    if (kind == OV_TOAST && (int32_t)(millis() - expiresAt) >= 0) dismiss();
+}
+
+void Overlay::compose(TFT_eSprite &dst) {
+    dirty = false;
+    if (kind == OV_NONE) return;
+
+    dst.fillRect(x, y, w, h, currentTheme->background);
+    dst.drawRect(x, y, w, h, currentTheme->accent);
+    dst.setTextColor(currentTheme->text, currentTheme->background);
+
+    if (kind == OV_TOAST) {
+        dst.setTextDatum(MC_DATUM);
+        dst.drawString(text, x + w/2, y + h/2);
+    } else if (kind == OV_DIALOG) {
+        dst.setTextDatum(MC_DATUM);
+        dst.drawString(text, x + w/2, y + GAP + OVERLAY_LINE/2);
+        int optionW = optionCount ? (w - (optionCount + 1) * GAP) / optionCount : 0;
+        for (int i = 0; i < optionCount; i++) {
+            int ox = x + GAP + i * (optionW + GAP);
+            int oy = y + 2 * GAP + OVERLAY_LINE;
+            if (i == focus) {
+                dst.fillRect(ox, oy, optionW, OVERLAY_LINE, currentTheme->focusBackground);
+                dst.setTextColor(currentTheme->focusText, currentTheme->focusBackground);
+            } else {
+                dst.drawRect(ox, oy, optionW, OVERLAY_LINE, currentTheme->border);
+                dst.setTextColor(currentTheme->text, currentTheme->background);
+            }
+            dst.drawString(options[i], ox + optionW/2, oy + OVERLAY_LINE/2);
+        }
+    } else {
+        dst.setTextDatum(ML_DATUM);
+        dst.setTextColor(currentTheme->accent, currentTheme->background);
+        dst.drawString(text, x + MARGIN, y + GAP + OVERLAY_LINE/2);
+        for (int i = 0; i < optionCount; i++) {
+            int oy = y + GAP + (i + 1) * OVERLAY_LINE;
+            if (i == focus) {
+                dst.fillRect(x + GAP, oy, w - 2 * GAP, OVERLAY_LINE, currentTheme->focusBackground);
+                dst.setTextColor(currentTheme->focusText, currentTheme->focusBackground);
+            } else {
+                dst.setTextColor(currentTheme->text, currentTheme->background);
+            }
+            dst.drawString(options[i], x + MARGIN, oy + OVERLAY_LINE/2);
+        }
+    }
+    onSprite = true;
+}
+
+// The page beneath was fully re-rendered, so nothing of the old overlay is left
+void Overlay::markRepainted() {
+    onSprite = false;
+    uncovered = false;
+    dirty = kind != OV_NONE;
+}
+
+bool Overlay::isDirty() const {
+    return dirty;
+}
+
+bool Overlay::isOnSprite() const {
+    return onSprite;
+}
+
+bool Overlay::intersects(int rx, int ry, int rw, int rh) const {
+    if (kind == OV_NONE) return false;
+    return rx < x + w && rx + rw > x && ry < y + h && ry + rh > y;
+}
+
+bool Overlay::takeUncovered(int& rx, int& ry, int& rw, int& rh) {
+    if (!uncovered) return false;
+    rx = uncoveredX;
+    ry = uncoveredY;
+    rw = uncoveredW;
+    rh = uncoveredH;
+    uncovered = false;
+    if (kind == OV_NONE) onSprite = false;
+    return true;
+}
+
+void Overlay::getRect(int& rx, int& ry, int& rw, int& rh) const {
+    rx = x;
+    ry = y;
+    rw = w;
+    rh = h;
+}
+
+// =============== StatePersistence Implementation ===============
+// Storage is split into two equal, block aligned slots. Each slot holds
+//   u32 sequence, u16 CRC-16/CCITT over the sequence and the record, state record
+// save() always writes the slot not holding the newest record, so losing power
+// mid-save leaves the previous record intact.
+static const size_t SLOT_HEADER = 6;
+
+StatePersistence::StatePersistence(StateStorage& storage, uint8_t* buffer, size_t size)
+    : storage(storage), buffer(buffer), size(size), savedStamp(0), stampValid(false),
+      activeSlot(-1), sequence(0) {}
+
+size_t StatePersistence::getSlotSize() const {
+    size_t blockSize = storage.getBlockSize();
+    return storage.getCapacity() / 2 / blockSize * blockSize;
+}
+
+// Reads the slot into buffer; returns its record length, or 0 if the slot is not valid
+size_t StatePersistence::readSlot(int slot, uint32_t& slotSequence) {
+    size_t address = slot * getSlotSize();
+    uint8_t header[SLOT_HEADER + STATE_HEADER];
+    if (!storage.read(address, header, sizeof(header))) return 0;
+
+    size_t total = header[SLOT_HEADER + 8] | (header[SLOT_HEADER + 9] << 8);
+    if (total < STATE_HEADER + 2 || SLOT_HEADER + total > size ||
+        SLOT_HEADER + total > getSlotSize()) {
+        return 0;
+    }
+    if (!storage.read(address, buffer, SLOT_HEADER + total)) return 0;
+
+    uint16_t crc = crc16(buffer, 4);
+    crc = crc16(buffer + SLOT_HEADER, total, crc);
+    if (crc != (buffer[4] | (buffer[5] << 8))) return 0;
+    memcpy(&slotSequence, buffer, sizeof(slotSequence));
+    return total;
+}
+
+// Call before the first frame is drawn
+bool StatePersistence::restore() {
+    activeSlot = -1;
+    uint32_t sequences[2];
+    bool valid[2];
+    for (int slot = 0; slot < 2; slot++) {
+        valid[slot] = readSlot(slot, sequences[slot]) > 0;
+    }
+
+    // Newest first; fall back to the older record if the newest does not load
+    int first = 0;
+    if (valid[0] && valid[1]) {
+        first = (int32_t)(sequences[1] - sequences[0]) > 0 ? 1 : 0;
+    } else if (valid[1]) {
+        first = 1;
+    }
+    for (int i = 0; i < 2; i++) {
+        int slot = i == 0 ? first : 1 - first;
+        if (!valid[slot]) continue;
+
+        uint32_t slotSequence;
+        size_t total = readSlot(slot, slotSequence);
+        if (total == 0 || !pageManager.loadState(buffer + SLOT_HEADER, total)) continue;
+
+        activeSlot = slot;
+        sequence = slotSequence;
+        savedStamp = pageManager.getStateStamp();
+        stampValid = true;
+        return true;
+    }
+
+    // Keep the newest valid record, even if it no longer matches the layout
+    if (valid[first]) {
+        activeSlot = first;
+        sequence = sequences[first];
+    }
+    return false;
+}
+
+// Returns the number of blocks written (0 if nothing changed), or -1 on error
+int StatePersistence::save() {
+    uint32_t stamp = pageManager.getStateStamp();
+    if (stampValid && stamp == savedStamp) return 0;
+    if (size <= SLOT_HEADER) return -1;
+
+    // Without a restore() first, find the newest record so it is not overwritten
+    if (activeSlot < 0) {
+        for (int slot = 0; slot < 2; slot++) {
+            uint32_t slotSequence;
+            if (readSlot(slot, slotSequence) == 0) continue;
+            if (activeSlot < 0 || (int32_t)(slotSequence - sequence) > 0) {
+                activeSlot = slot;
+                sequence = slotSequence;
+            }
+        }
+    }
+
+    size_t length = pageManager.saveState(buffer + SLOT_HEADER, size - SLOT_HEADER);
+    if (length == 0) return -1;
+    length += SLOT_HEADER;
+    size_t slotSize = getSlotSize();
+    if (length > slotSize) return -1;
+
+    uint32_t nextSequence = sequence + 1;
+    memcpy(buffer, &nextSequence, sizeof(nextSequence));
+    uint16_t crc = crc16(buffer, 4);
+    crc = crc16(buffer + SLOT_HEADER, length - SLOT_HEADER, crc);
+    buffer[4] = crc & 0xFF;
+    buffer[5] = crc >> 8;
+
+    // Compare against what the other slot holds and rewrite only the blocks that differ
+    int slot = activeSlot == 0 ? 1 : 0;
+    size_t address = slot * slotSize;
+    size_t blockSize = storage.getBlockSize();
+    int written = 0;
+    for (size_t block = 0; block < length; block += blockSize) {
+        size_t blockLength = length - block < blockSize ? length - block : blockSize;
+
+        bool same = true;
+        uint8_t stored[32];
+        for (size_t off = 0; off < blockLength && same; off += sizeof(stored)) {
+            size_t chunk = blockLength - off < sizeof(stored) ? blockLength - off : sizeof(stored);
+            if (!storage.read(address + block + off, stored, chunk)) return -1;
+            same = memcmp(stored, buffer + block + off, chunk) == 0;
+        }
+        if (same) continue;
+
+        if (!storage.writeBlock(address + block, buffer + block, blockLength)) return -1;
+        written++;
+    }
+
+    activeSlot = slot;
+    sequence = nextSequence;
+    savedStamp = stamp;
+    stampValid = true;
+    return written;
+}
+
+// =============== Utility Functions ===============
+void initDisplay() {
+    tft.init();
+    tft.setRotation(3);
+    tft.setTextColor(TFT_WHITE);
+    tft.setTextFont(2);
+    
+    pageSprite.createSprite(tft.width(), tft.height());
+    
+    pinMode(WIO_5S_UP, INPUT_PULLUP);
+    pinMode(WIO_5S_DOWN, INPUT_PULLUP);
+    pinMode(WIO_5S_LEFT, INPUT_PULLUP);
+    pinMode(WIO_5S_RIGHT, INPUT_PULLUP);
+    pinMode(WIO_5S_PRESS, INPUT_PULLUP);
+}
+
+void handleInput() {
+    // Threaded mode: the render task owns the page state, so only post commands
+    if (renderQueue.isEnabled()) {
+        if (digitalRead(WIO_5S_UP) == LOW) { renderQueue.moveFocus(CMD_MOVE_UP); delay(150); }
+        if (digitalRead(WIO_5S_DOWN) == LOW) { renderQueue.moveFocus(CMD_MOVE_DOWN); delay(150); }
+        if (digitalRead(WIO_5S_LEFT) == LOW) { renderQueue.moveFocus(CMD_MOVE_LEFT); delay(150); }
+        if (digitalRead(WIO_5S_RIGHT) == LOW) { renderQueue.moveFocus(CMD_MOVE_RIGHT); delay(150); }
+        if (digitalRead(WIO_5S_PRESS) == LOW) { renderQueue.press(); delay(200); }
+        renderQueue.dispatchEvents();
+        return;
+    }
+
+    // An open dialog or menu takes the 5-way input
+    if (overlay.handleInput()) return;
+
+    Page* currentPage = pageManager.getCurrentPage();
+    if (!currentPage) return;
+
+    if (digitalRead(WIO_5S_UP) == LOW) { 
+        currentPage->navigateUp(pageManager.selRow, pageManager.selCol); 
+        delay(150); 
+    }
+    if (digitalRead(WIO_5S_DOWN) == LOW) { 
+        currentPage->navigateDown(pageManager.selRow, pageManager.selCol); 
+        delay(150); 
+    }
+    if (digitalRead(WIO_5S_LEFT) == LOW) { 
+        currentPage->navigateLeft(pageManager.selRow, pageManager.selCol); 
+        delay(150); 
+    }
+    if (digitalRead(WIO_5S_RIGHT) == LOW) { 
+        currentPage->navigateRight(pageManager.selRow, pageManager.selCol); 
+        delay(150); 
+    }
+
+    if (digitalRead(WIO_5S_PRESS) == LOW) {
+        Widget* w = currentPage->getWidget(pageManager.selRow, pageManager.selCol);
+        if (w) {
             switch (w->getType()) {
                 case W_RADIO:
                     currentPage->selectRadioInRow(pageManager.selRow, static_cast<RadioButton*>(w));
@@ -576,32 +2418,54 @@ void handleInput() {
     }
 }
 
+// Push a rectangle of pageSprite to the display without sending the whole frame
+void pushRect(int x, int y, int w, int h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > pageSprite.width()) w = pageSprite.width() - x;
+    if (y + h > pageSprite.height()) h = pageSprite.height() - y;
+    if (w <= 0 || h <= 0) return;
+
+    uint16_t* buffer = static_cast<uint16_t*>(pageSprite.getPointer());
+    int stride = pageSprite.width();
+    bool oldSwapBytes = tft.getSwapBytes();
+    tft.setSwapBytes(false);
+    tft.startWrite();
+    for (int row = y; row < y + h; row++) {
+        tft.pushImage(x, row, w, 1, buffer + row * stride + x);
+    }
+    tft.endWrite();
+    tft.setSwapBytes(oldSwapBytes);
+}
+
 void handleSerialCommands() {
     if (Serial.available()) {
         String command = Serial.readStringUntil('\n');
         command.trim();
+        bool threaded = renderQueue.isEnabled();
         
+        ColorScheme* theme = nullptr;
+        if (command == "theme:red") theme = &redTheme;
+        else if (command == "theme:blue") theme = &blueTheme;
+        else if (command == "theme:green") theme = &greenTheme;
+        else if (command == "theme:default") theme = &defaultTheme;
+
         if (command.startsWith("page:")) {
             String pageName = command.substring(5);
-            pageManager.navigateToPage(pageName.c_str());
-        }
-        else if (command == "theme:red") {
-            pageManager.setTheme(&redTheme);
-        }
-        else if (command == "theme:blue") {
-            pageManager.setTheme(&blueTheme);
+            if (threaded) renderQueue.navigateToPage(pageName.c_str());
+            else pageManager.navigateToPage(pageName.c_str());
         }
-        else if (command == "theme:green") {
-            pageManager.setTheme(&greenTheme);
-        }
-        else if (command == "theme:default") {
-            pageManager.setTheme(&defaultTheme);
+        else if (theme) {
+            if (threaded) renderQueue.setTheme(theme);
+            else pageManager.setTheme(theme);
         }
         else if (command == "back") {
-            pageManager.goBack();
+            if (threaded) renderQueue.goBack();
+            else pageManager.goBack();
         }
         else if (command == "next") {
-            pageManager.goNext();
+            if (threaded) renderQueue.goNext();
+            else pageManager.goNext();
         }
         else if (command == "help") {
             Serial.println("=== Serial Commands ===");
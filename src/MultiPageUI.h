@@ -3,6 +3,7 @@
 
 #include <TFT_eSPI.h>
 #include <Arduino.h>
+#include <atomic>
 
 namespace MultiPageUI {
 
@@ -39,15 +40,31 @@ extern ColorScheme greenTheme;
 extern ColorScheme* currentTheme;
 
 // Widget types
-enum WidgetType { W_LABEL, W_BUTTON, W_RADIO, W_CHECKBOX, W_LINK };
+enum WidgetType { W_LABEL, W_BUTTON, W_RADIO, W_CHECKBOX, W_LINK, W_CHART, W_IMAGE };
 
 // Base widget class
 class Widget {
 public:
     virtual void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) = 0;
     virtual void onPress() {}
+    // Incremental redraw of an unchanged cell; return true if the cell was updated in place
+    virtual bool update(TFT_eSprite &, int, int, int, int, bool) { return false; }
+    virtual bool hasPendingUpdate() const { return false; }
     virtual WidgetType getType() const = 0;
+    // True if every visible change bumps the revision. Pages holding a widget
+    // that does not (the default, e.g. one drawing a clock) are fully redrawn each frame
+    virtual bool tracksChanges() const { return false; }
     virtual ~Widget() {}
+    uint16_t getRevision() const { return revision; }
+    // Mark the widget changed, e.g. after rewriting a text buffer it points to
+    void invalidate() { touch(); }
+
+protected:
+    // Bumped whenever the widget's visible state changes
+    void touch() { revision++; }
+
+private:
+    uint16_t revision = 0;
 };
 
 // Label widget
@@ -58,6 +75,7 @@ public:
     const char* getText() const;
     void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) override;
     WidgetType getType() const override;
+    bool tracksChanges() const override;
 
 private:
     char text[32];
@@ -72,6 +90,7 @@ public:
     void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) override;
     void onPress() override;
     WidgetType getType() const override;
+    bool tracksChanges() const override;
 
 private:
     char text[32];
@@ -87,6 +106,7 @@ public:
     void deselect();
     bool isSelected() const;
     WidgetType getType() const override;
+    bool tracksChanges() const override;
 
 private:
     const char* text;
@@ -99,8 +119,10 @@ public:
     CheckBox(const char* text, bool checked = false);
     void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) override;
     void toggle();
+    void setChecked(bool value);
     bool isChecked() const;
     WidgetType getType() const override;
+    bool tracksChanges() const override;
 
 private:
     const char* text;
@@ -114,6 +136,7 @@ public:
     void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) override;
     void onPress() override;
     WidgetType getType() const override;
+    bool tracksChanges() const override;
     const char* getRoute() const;
 
 private:
@@ -121,8 +144,162 @@ private:
     const char* route;
 };
 
+// Lock-free single-producer/single-consumer ring over caller storage (holds size - 1 items)
+template <typename T>
+class SpscQueue {
+public:
+    SpscQueue() : items(nullptr), capacity(0), writeIndex(0), readIndex(0) {}
+    SpscQueue(T* storage, size_t size) : items(storage), capacity(size), writeIndex(0), readIndex(0) {}
+
+    // Not thread safe: call before either side uses the queue
+    void begin(T* storage, size_t size) {
+        items = storage;
+        capacity = size;
+        writeIndex.store(0);
+        readIndex.store(0);
+    }
+
+    bool push(const T& item) {
+        if (capacity < 2) return false;
+        size_t write = writeIndex.load(std::memory_order_relaxed);
+        size_t next = (write + 1) % capacity;
+        if (next == readIndex.load(std::memory_order_acquire)) return false;
+        items[write] = item;
+        writeIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t read = readIndex.load(std::memory_order_relaxed);
+        if (read == writeIndex.load(std::memory_order_acquire)) return false;
+        item = items[read];
+        readIndex.store((read + 1) % capacity, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+    // Items currently queued; exact on the consumer side, a lower bound while the producer runs
+    size_t size() const {
+        if (capacity == 0) return 0;
+        size_t read = readIndex.load(std::memory_order_acquire);
+        size_t write = writeIndex.load(std::memory_order_acquire);
+        return (write + capacity - read) % capacity;
+    }
+
+private:
+    T* items;
+    size_t capacity;
+    std::atomic<size_t> writeIndex;
+    std::atomic<size_t> readIndex;
+};
+
+// Scrolling chart (sparkline) widget
+class Chart : public Widget {
+public:
+    Chart(float minValue, float maxValue, uint16_t samplesPerColumn = 1);
+    void addSample(float value);
+    // Threaded mode: lock-free hand-off from the app task, drained by the render task
+    bool postSample(float value);
+    void setRange(float minValue, float maxValue);
+    void setSamplesPerColumn(uint16_t samples);
+    void clear();
+    void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) override;
+    bool update(TFT_eSprite &dst, int x, int y, int w, int h, bool focused) override;
+    bool hasPendingUpdate() const override;
+    WidgetType getType() const override;
+    bool tracksChanges() const override;
+
+private:
+    static const int MAX_COLUMNS = 320;
+    static const int SAMPLE_RING = 256;
+
+    uint8_t quantize(float value) const;
+    void foldSample(uint8_t q);
+    void drainSamples();
+    void drawColumns(TFT_eSprite &dst, int x, int y, int w, int h, int count);
+
+    float minValue, maxValue;
+    uint16_t samplesPerColumn;
+
+    // Ring buffer of decimated columns (quantized min/max per column)
+    uint8_t columnMin[MAX_COLUMNS];
+    uint8_t columnMax[MAX_COLUMNS];
+    int head;
+    int filled;
+    int pending;
+
+    // Column currently being accumulated
+    uint8_t accMin, accMax;
+    uint16_t accCount;
+
+    // Quantized samples posted from another task
+    uint8_t sampleStorage[SAMPLE_RING];
+    SpscQueue<uint8_t> samples;
+};
+
+// Compressed image stored in flash (see tools/image2asset.py).
+// Pixels are palette-indexed runs, row-major: one byte per run with the
+// palette index in the high nibble and length - 1 in the low nibble;
+// a low nibble of 15 means the length is 16 + the following byte.
+struct ImageAsset {
+    uint16_t width;
+    uint16_t height;
+    uint8_t paletteSize;
+    uint8_t transparent;      // Palette index left undrawn, 0xFF if none
+    const uint16_t* palette;  // RGB565
+    const uint8_t* data;
+    uint32_t length;
+};
+
+// Image/icon widget, decoded straight into the destination sprite
+class Image : public Widget {
+public:
+    Image(const ImageAsset* asset);
+    void setAsset(const ImageAsset* newAsset);
+    const ImageAsset* getAsset() const;
+    void draw(TFT_eSprite &dst, int x, int y, int w, int h, bool focused = false) override;
+    WidgetType getType() const override;
+    bool tracksChanges() const override;
+
+private:
+    const ImageAsset* asset;
+};
+
+// Optional cache of decoded icons in a caller-provided buffer
+class IconCache {
+public:
+    IconCache();
+    void begin(void* buffer, size_t size);
+    const uint16_t* find(const ImageAsset* asset, uint16_t background);
+    uint16_t* insert(const ImageAsset* asset, uint16_t background);
+    void clear();
+    size_t getBytesUsed() const;
+
+private:
+    static const int MAX_ENTRIES = 8;
+
+    struct Entry {
+        const ImageAsset* asset;
+        uint16_t background;
+        uint16_t* pixels;
+    };
+
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    Entry entries[MAX_ENTRIES];
+    int count;
+};
+
 // Forward declaration
 class PageManager;
+class SnapshotCache;
+
+// Page transition styles
+enum TransitionStyle { T_NONE, T_SLIDE };
 
 // Page class
 class Page {
@@ -142,11 +319,31 @@ public:
     bool navigateLeft(int& row, int& col);
     bool navigateRight(int& row, int& col);
     int getScrollOffset() const;
+    void setScrollOffset(int offset);
+    void prepareRestore();
+    void invalidate();
 
 private:
+    friend class SnapshotCache;
+
+    void getCellRect(int visibleRow, int col, int& x, int& y, int& w, int& h);
+    void redrawChangedCells(int selRow, int selCol, bool pushCells);
+    void repaintRow(int visibleRow, int selRow, int selCol);
+    void drawScrollIndicatorBand(int bandY, int bandH);
+    void repaintRect(int x, int y, int w, int h);
+    void recordDrawnState(int selRow, int selCol);
+    bool tracksChanges();
+
     Widget* widgets[8][3];  // TOTAL_ROWS x COLS
     int scrollOffset;
     const char* name;
+
+    // State of the last frame rendered for this page
+    uint16_t drawnRevision[8][3];
+    int drawnSelRow, drawnSelCol;
+    int drawnScrollOffset;
+    ColorScheme* drawnTheme;
+    bool restorePending;
 };
 
 // Page manager class
@@ -154,12 +351,21 @@ class PageManager {
 public:
     PageManager();
     void addPage(Page* page);
+    void removePage(Page* page);
     void navigateToPage(const char* pageName);
     void goBack();
     void goNext();
     Page* getCurrentPage();
     const char* getCurrentPageName();
     void setTheme(ColorScheme* theme);
+    void setTransition(TransitionStyle style, int steps = 8);
+    void present();
+
+    // Binary state snapshot (see MultiPageUI.cpp for the format)
+    size_t saveState(uint8_t* buffer, size_t size);
+    bool loadState(const uint8_t* buffer, size_t length);
+    uint32_t getLayoutSignature();
+    uint32_t getStateStamp();
 
     int selRow = 1, selCol = 0;
 
@@ -169,15 +375,337 @@ private:
     int currentPageIndex;
     int numPages;
     int findFirstValidRow();
+    void showPage(int index, int direction);
+    void resetSelection();
+    bool applyState(const uint8_t* buffer, size_t end, bool apply);
+
+    TransitionStyle transition;
+    int transitionSteps;
+    Page* transitionFrom;
+    int transitionDirection;
+};
+
+// Cache of RLE/palette compressed snapshots of recently shown pages.
+// Disabled until begin() gives it a buffer. Frames with more than 16 distinct
+// colors (e.g. pages showing a multi-colored Image) cannot be stored and are
+// counted by getSkipped().
+class SnapshotCache {
+public:
+    SnapshotCache();
+    void begin(void* buffer, size_t size);
+    bool store(Page* page);
+    bool restore(Page* page);
+    bool slide(Page* from, int direction, int steps);
+    void invalidate(Page* page);
+    void clear();
+    void setOwner(Page* page);
+    Page* getOwner() const;
+    size_t getBytesUsed() const;
+    int getCount() const;
+    uint32_t getSkipped() const;
+
+private:
+    static const int MAX_SLOTS = 4;
+    static const int MAX_PALETTE = 16;
+    static const int MAX_LINE = 320;
+
+    struct Snapshot {
+        Page* page;
+        ColorScheme* theme;
+        int16_t scrollOffset;
+        int16_t selRow, selCol;
+        uint16_t revision[8][3];
+        uint16_t palette[MAX_PALETTE];
+        uint8_t paletteSize;
+        uint32_t pixels;
+        size_t offset;
+        size_t length;
+        uint32_t lastUse;
+    };
+
+    // Sequential reader over an encoded run stream
+    struct RunReader {
+        const uint8_t* pos;
+        const uint8_t* end;
+        const uint16_t* palette;
+        uint16_t color;
+        int remaining;
+        void fill(uint16_t* dst, int count);
+    };
+
+    int find(Page* page);
+    void remove(int index);
+    bool evictOldest(Page* keep);
+    long encode(const uint16_t* px, size_t pixels, Snapshot& snap, uint8_t* out, size_t capacity);
+
+    Snapshot slots[MAX_SLOTS];
+    int count;
+    size_t used;
+    uint32_t useCounter;
+    uint32_t skipped;
+    Page* owner;
+    uint8_t* pool;
+    size_t capacity;
+    uint16_t* line;  // Slide transition row buffer, carved from the front of the buffer
+};
+
+// Bump allocator over a caller-provided buffer
+class Arena {
+public:
+    // Every allocation is rounded to this, so sizes computed with bytesFor() are exact.
+    // They do not include the up to ALIGN - 1 bytes skipped at the start of an
+    // unaligned buffer; use StaticArena or an alignas(Arena::ALIGN) buffer.
+    static const size_t ALIGN = alignof(void*);
+
+    Arena(void* buffer, size_t size);
+    void* allocate(size_t size);
+    const char* copyString(const char* str);
+    size_t mark() const;
+    void reset(size_t mark = 0);
+    size_t getUsed() const;
+    size_t getPeak() const;
+    size_t getCapacity() const;
+
+    template <typename T>
+    static constexpr size_t bytesFor(size_t count = 1) {
+        return count * ((sizeof(T) + ALIGN - 1) / ALIGN * ALIGN);
+    }
+    static constexpr size_t bytesForText(size_t length) {
+        return (length + 1 + ALIGN - 1) / ALIGN * ALIGN;
+    }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+};
+
+// Arena with its own statically sized storage
+template <size_t N>
+class StaticArena : public Arena {
+public:
+    StaticArena() : Arena(storage, N) {}
+
+private:
+    alignas(Arena::ALIGN) uint8_t storage[N];
+};
+
+// Rolls the arena back to where it was when the scope was entered.
+// Pages built inside the scope must be passed to pageManager.removePage() before
+// it ends, or pageManager keeps pointers into the released memory.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : arena(arena), savedMark(arena.mark()) {}
+    ~ArenaScope() { arena.reset(savedMark); }
+
+private:
+    Arena& arena;
+    size_t savedMark;
+};
+
+// Builds a Page at runtime with all widgets and text placed in an Arena
+class PageBuilder {
+public:
+    PageBuilder(Arena& arena, const char* pageName);
+    Label* addLabel(int row, int col, const char* text);
+    Button* addButton(int row, int col, const char* text, void (*handler)());
+    RadioButton* addRadio(int row, int col, const char* text, bool selected = false);
+    CheckBox* addCheckBox(int row, int col, const char* text, bool checked = false);
+    Link* addLink(int row, int col, const char* text, const char* route);
+    Chart* addChart(int row, int col, float minValue, float maxValue, uint16_t samplesPerColumn = 1);
+    Image* addImage(int row, int col, const ImageAsset* asset);
+    Page* build(ColorScheme* theme = nullptr);
+
+private:
+    void* allocateCell(int row, int col, size_t size);
+
+    Arena& arena;
+    const char* name;
+    Widget* grid[8][3];
+    bool failed;
+};
+
+// State change posted to the render task
+enum CommandType {
+    CMD_SET_LABEL_TEXT, CMD_SET_BUTTON_TEXT, CMD_TOGGLE, CMD_SELECT_RADIO,
+    CMD_NAVIGATE, CMD_BACK, CMD_NEXT, CMD_SET_THEME,
+    CMD_MOVE_UP, CMD_MOVE_DOWN, CMD_MOVE_LEFT, CMD_MOVE_RIGHT, CMD_PRESS,
+    CMD_SHOW_TOAST, CMD_SHOW_DIALOG, CMD_SHOW_MENU, CMD_DISMISS_OVERLAY
+};
+
+struct UICommand {
+    CommandType type;
+    Widget* target;
+    Page* page;
+    ColorScheme* theme;
+    int row;
+    char text[32];
+    uint32_t durationMs;              // CMD_SHOW_TOAST
+    const char* const* options;       // CMD_SHOW_DIALOG / CMD_SHOW_MENU
+    int optionCount;
+    void (*handler)(int);
+};
+
+// Handler to run on the app side: a pressed Button, or an overlay choice
+struct UIEvent {
+    Button* button;
+    void (*handler)(int);
+    int choice;
+};
+
+// Threaded mode: the app/input side posts commands, a dedicated render task
+// owns pageSprite and the display and applies them between frames.
+// Off until enable() is given storage for the command ring.
+class RenderQueue {
+public:
+    RenderQueue();
+    void enable(UICommand* buffer, size_t count);
+    void disable();
+    bool isEnabled() const;
+
+    // Producer side (app/input task)
+    bool setText(Label* label, const char* text);
+    bool setText(Button* button, const char* text);
+    bool toggle(CheckBox* checkBox);
+    bool selectRadio(Page* page, int row, RadioButton* radio);
+    bool navigateToPage(const char* pageName);
+    bool goBack();
+    bool goNext();
+    bool setTheme(ColorScheme* theme);
+    bool moveFocus(CommandType direction);
+    bool press();
+    bool addSample(Chart* chart, float value);
+    bool showToast(const char* text, uint32_t durationMs = 2000);
+    bool showDialog(const char* message, const char* const* options, int count, void (*handler)(int));
+    bool showMenu(const char* title, const char* const* options, int count, void (*handler)(int));
+    bool dismissOverlay();
+    int dispatchEvents();
+    uint32_t getDropped() const;
+
+    // Consumer side (render task)
+    int applyPending();
+    void renderFrame();
+
+private:
+    bool post(UICommand& command);
+    void apply(const UICommand& command);
+
+    static const int MAX_EVENTS = 16;
+
+    bool postEvent(const UIEvent& event);
+    bool postOverlay(CommandType type, const char* text, const char* const* options, int count, void (*handler)(int));
+
+    SpscQueue<UICommand> commands;
+    UIEvent eventStorage[MAX_EVENTS];
+    SpscQueue<UIEvent> events;  // Handlers run back on the app side
+    std::atomic<bool> enabled;
+    std::atomic<uint32_t> dropped;
+};
+
+// Dialog, toast or pop-up menu drawn over the current page.
+// Hiding it repaints only the covered rectangle from the page beneath.
+class Overlay {
+public:
+    Overlay();
+    void showToast(const char* text, uint32_t durationMs = 2000);
+    void showDialog(const char* message, const char* const* options, int count, void (*handler)(int));
+    void showMenu(const char* title, const char* const* options, int count, void (*handler)(int));
+    void dismiss();
+    bool isVisible() const;
+    bool isModal() const;
+
+    // Input capture while a dialog or menu is open
+    bool handleInput();
+    bool navigate(CommandType direction);
+    bool press();
+    bool choose(int& choice, void (*&callback)(int));
+
+    // Used by Page::draw
+    void update();
+    void compose(TFT_eSprite &dst);
+    void markRepainted();
+    bool isDirty() const;
+    bool isOnSprite() const;
+    bool intersects(int x, int y, int w, int h) const;
+    bool takeUncovered(int& x, int& y, int& w, int& h);
+    void getRect(int& x, int& y, int& w, int& h) const;
+
+private:
+    enum Kind { OV_NONE, OV_TOAST, OV_DIALOG, OV_MENU };
+
+    void open(Kind newKind, const char* newText, const char* const* newOptions, int count, void (*newHandler)(int));
+    void uncover();
+    void layout();
+
+    Kind kind;
+    char text[32];
+    const char* const* options;
+    int optionCount;
+    int focus;
+    void (*handler)(int);
+    uint32_t expiresAt;
+
+    int x, y, w, h;
+    bool dirty;       // Needs to be composed and pushed
+    bool onSprite;    // pageSprite currently holds overlay pixels
+    bool uncovered;   // Area below a hidden/moved overlay still has to be repainted
+    int uncoveredX, uncoveredY, uncoveredW, uncoveredH;
+};
+
+// Block storage for persisted UI state (flash / EEPROM emulation)
+class StateStorage {
+public:
+    virtual size_t getBlockSize() const = 0;
+    virtual size_t getCapacity() const = 0;
+    virtual bool read(size_t address, uint8_t* data, size_t length) = 0;
+    // Address is block aligned and length never exceeds one block
+    virtual bool writeBlock(size_t address, const uint8_t* data, size_t length) = 0;
+    virtual ~StateStorage() {}
+};
+
+// Saves/restores PageManager state, rewriting only blocks that changed.
+// Alternates between two records in storage so an interrupted save keeps the
+// previous one; buffer must hold a record plus 6 bytes of slot header.
+class StatePersistence {
+public:
+    StatePersistence(StateStorage& storage, uint8_t* buffer, size_t size);
+    bool restore();
+    int save();
+
+private:
+    size_t getSlotSize() const;
+    size_t readSlot(int slot, uint32_t& slotSequence);
+
+    StateStorage& storage;
+    uint8_t* buffer;
+    size_t size;
+    uint32_t savedStamp;
+    bool stampValid;
+    int activeSlot;     // Slot holding the newest valid record, -1 if none
+    uint32_t sequence;  // Sequence number of that record
 };
 
 // Global page manager instance
 extern PageManager pageManager;
 
+// Global snapshot cache instance
+extern SnapshotCache snapshotCache;
+
+// Global decoded icon cache (disabled until begin() is called)
+extern IconCache iconCache;
+
+// Global render command queue (threaded mode is off until enable() is called)
+extern RenderQueue renderQueue;
+
+// Global overlay layer
+extern Overlay overlay;
+
 // Utility functions
 void initDisplay();
 void handleInput();
 void handleSerialCommands();
+void pushRect(int x, int y, int w, int h);
 
 } // namespace MultiPageUI
 
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Convert an image into a MultiPageUI::ImageAsset C header.
+
+Usage:
+    python3 image2asset.py icon.png [name] > icon.h
+
+The image is reduced to at most 16 colors (pixels with alpha < 128 become
+the transparent palette entry) and encoded as palette-indexed runs, the
+same format the library uses for page snapshots. Requires Pillow.
+"""
+
+import os
+import sys
+
+from PIL import Image
+
+MAX_COLORS = 16
+
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def load_indexed(path):
+    img = Image.open(path).convert("RGBA")
+    width, height = img.size
+    pixels = list(img.getdata())
+    transparent = any(a < 128 for (_, _, _, a) in pixels)
+
+    # Quantize the opaque colors, keeping one slot for transparency
+    opaque = Image.new("RGB", img.size)
+    opaque.putdata([(r, g, b) for (r, g, b, _) in pixels])
+    quantized = opaque.quantize(colors=MAX_COLORS - 1 if transparent else MAX_COLORS)
+    raw_palette = quantized.getpalette()
+
+    palette = []
+    remap = {}
+    indices = []
+    for i, q in enumerate(quantized.getdata()):
+        if pixels[i][3] < 128:
+            indices.append(None)
+            continue
+        if q not in remap:
+            remap[q] = len(palette)
+            palette.append(rgb565(*raw_palette[q * 3:q * 3 + 3]))
+        indices.append(remap[q])
+
+    transparent_index = 0xFF
+    if transparent:
+        transparent_index = len(palette)
+        palette.append(0)
+        indices = [transparent_index if i is None else i for i in indices]
+
+    return width, height, palette, transparent_index, indices
+
+
+def encode_runs(indices):
+    out = bytearray()
+    i = 0
+    while i < len(indices):
+        value = indices[i]
+        run = 1
+        while i + run < len(indices) and indices[i + run] == value and run < 16 + 255:
+            run += 1
+        if run < 16:
+            out.append((value << 4) | (run - 1))
+        else:
+            out.append((value << 4) | 15)
+            out.append(run - 16)
+        i += run
+    return out
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    path = sys.argv[1]
+    name = sys.argv[2] if len(sys.argv) > 2 else os.path.splitext(os.path.basename(path))[0]
+    name = "".join(c if c.isalnum() else "_" for c in name)
+
+    width, height, palette, transparent, indices = load_indexed(path)
+    data = encode_runs(indices)
+
+    print("// Generated by image2asset.py from %s" % os.path.basename(path))
+    print("// %dx%d, %d colors, %d bytes (raw RGB565: %d bytes)" % (
+        width, height, len(palette), len(data), width * height * 2))
+    print("#pragma once")
+    print("#include <MultiPageUI.h>")
+    print()
+    print("static const uint16_t %s_palette[] = {" % name)
+    print("    " + ", ".join("0x%04X" % c for c in palette))
+    print("};")
+    print()
+    print("static const uint8_t %s_data[] = {" % name)
+    for offset in range(0, len(data), 16):
+        print("    " + ", ".join("0x%02X" % b for b in data[offset:offset + 16]) + ",")
+    print("};")
+    print()
+    print("static const MultiPageUI::ImageAsset %s = {" % name)
+    print("    %d, %d, %d, 0x%02X, %s_palette, %s_data, sizeof(%s_data)" % (
+        width, height, len(palette), transparent, name, name, name))
+    print("};")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())